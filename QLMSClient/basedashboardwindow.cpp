@@ -23,6 +23,13 @@ BaseDashboardWindow::BaseDashboardWindow(const QString &username, int userId, QW
 
     statusBar()->showMessage(QString("Logged in as: %1").arg(username));
 
+    // Short drops are bridged by NetworkManager; disconnected() means the session is gone
+    connect(&NetworkManager::instance(), &NetworkManager::reconnecting, this, [this]() {
+        statusBar()->showMessage("Connection lost, reconnecting...");
+    });
+    connect(&NetworkManager::instance(), &NetworkManager::sessionResumed, this, [this]() {
+        statusBar()->showMessage(QString("Logged in as: %1").arg(m_username));
+    });
     connect(&NetworkManager::instance(), &NetworkManager::disconnected, this, [this]() {
         QMessageBox::warning(this, "Disconnected", "Connection to server lost");
         close();
@@ -103,13 +103,13 @@ void ClassManagementWidget::setupUi()
 
 void ClassManagementWidget::onRefreshClasses()
 {
-    NetworkManager::instance().sendCommand("GET_ALL_CLASSES",
-                                           QJsonObject(),
-                                           [this](const QJsonObject &response) {
-                                               if (response["type"].toString() == "DATA_RESPONSE") {
-                                                   populateClasses(response["data"].toArray());
-                                               }
-                                           });
+    NetworkManager::instance().sendCached("GET_ALL_CLASSES",
+                                          QJsonObject(),
+                                          [this](const QJsonObject &response) {
+                                              if (response["type"].toString() == "DATA_RESPONSE") {
+                                                  populateClasses(response["data"].toArray());
+                                              }
+                                          });
 }
 
 void ClassManagementWidget::onAddClass()
@@ -169,21 +169,20 @@ void ClassManagementWidget::onClassSelected()
     QJsonObject data;
     data["class_id"] = classId;
 
-    NetworkManager::instance().sendCommand("GET_COURSES_FOR_CLASS",
-                                           data,
-                                           [this](const QJsonObject &response) {
-                                               if (response["type"].toString() == "DATA_RESPONSE") {
-                                                   populateCourses(response["data"].toArray());
-                                               }
-                                           });
+    NetworkManager::instance().sendCached("GET_COURSES_FOR_CLASS",
+                                          data,
+                                          [this](const QJsonObject &response) {
+                                              if (response["type"].toString() == "DATA_RESPONSE") {
+                                                  populateCourses(response["data"].toArray());
+                                              }
+                                          });
 
-    NetworkManager::instance().sendCommand("GET_CLASS_MEMBERS",
-                                           data,
-                                           [this](const QJsonObject &response) {
-                                               if (response["type"].toString() == "DATA_RESPONSE") {
-                                                   populateMembers(response["data"].toArray());
-                                               }
-                                           });
+    NetworkManager::instance()
+        .sendPagedAll("GET_CLASS_MEMBERS", data, [this](const QJsonObject &response) {
+            if (response["type"].toString() == "DATA_RESPONSE") {
+                populateMembers(response["data"].toArray());
+            }
+        });
 }
 
 void ClassManagementWidget::onAddCourse()
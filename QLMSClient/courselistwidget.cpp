@@ -12,7 +12,9 @@
 #include <QPushButton>
 #include <QRadioButton>
 #include <QScrollArea>
+#include <QSet>
 #include <QSplitter>
+#include <QTextCursor>
 #include <QTextEdit>
 #include <QTreeWidget>
 #include <QTreeWidgetItem>
@@ -23,6 +25,18 @@ CourseListWidget::CourseListWidget(int studentId, QWidget *parent)
     , m_studentId(studentId)
 {
     setupUi();
+
+    // Materials added to or removed from the listed courses arrive as events
+    connect(&NetworkManager::instance(),
+            &NetworkManager::eventReceived,
+            this,
+            &CourseListWidget::handleEvent);
+    // Catch up on events missed while the connection was down
+    connect(&NetworkManager::instance(),
+            &NetworkManager::sessionResumed,
+            this,
+            &CourseListWidget::onRefresh);
+
     onRefresh();
 }
 
@@ -99,12 +113,11 @@ void CourseListWidget::setupUi()
 
 void CourseListWidget::onRefresh()
 {
-    m_materialsTreeWidget->clear();
-    NetworkManager::instance().sendCommand("GET_ALL_CLASSES",
-                                           QJsonObject(),
-                                           [this](const QJsonObject &response) {
-                                               handleClassesResponse(response);
-                                           });
+    NetworkManager::instance().sendCached("GET_CLASS_TREE",
+                                          QJsonObject(),
+                                          [this](const QJsonObject &response) {
+                                              handleClassesResponse(response);
+                                          });
 }
 
 void CourseListWidget::onItemSelected()
@@ -116,21 +129,20 @@ void CourseListWidget::onItemSelected()
     QString type = item->text(1);
     clearContentArea();
 
-    if (type == "lesson" || type == "quiz") {
+    if (type == "lesson") {
+        displayTextLesson(item->text(2).toInt(), item->text(0));
+    } else if (type == "quiz") {
         int materialId = item->text(2).toInt();
         QJsonObject data;
         data["material_id"] = materialId;
-        NetworkManager::instance()
-            .sendCommand("GET_MATERIAL_DETAILS", data, [this, type](const QJsonObject &response) {
-                if (response["type"] == "DATA_RESPONSE") {
+        int generation = m_contentGeneration;
+        NetworkManager::instance().sendCached(
+            "GET_MATERIAL_DETAILS", data, [this, generation](const QJsonObject &response) {
+                if (generation == m_contentGeneration && response["type"] == "DATA_RESPONSE") {
                     QJsonObject material = response["data"].toObject();
-                    if (type == "lesson") {
-                        displayTextLesson(material);
-                    } else {
-                        m_currentQuiz = material;
-                        m_contentGroup->setTitle(material["title"].toString());
-                        m_startQuizButton->show();
-                    }
+                    m_currentQuiz = material;
+                    m_contentGroup->setTitle(material["title"].toString());
+                    m_startQuizButton->show();
                 }
             });
     }
@@ -201,6 +213,8 @@ void CourseListWidget::onSubmitQuiz()
 void CourseListWidget::handleClassesResponse(const QJsonObject &response)
 {
     if (response["type"].toString() == "DATA_RESPONSE") {
+        // Also called again when the cached tree turns out to be stale
+        m_materialsTreeWidget->clear();
         QJsonArray classes = response["data"].toArray();
         for (const auto &val : classes) {
             QJsonObject classObj = val.toObject();
@@ -208,56 +222,102 @@ void CourseListWidget::handleClassesResponse(const QJsonObject &response)
             classItem->setText(0, classObj["class_name"].toString());
             classItem->setText(1, "class");
 
-            QJsonObject data;
-            data["class_id"] = classObj["class_id"].toInt();
-            NetworkManager::instance().sendCommand("GET_COURSES_FOR_CLASS",
-                                                   data,
-                                                   [this,
-                                                    classItem](const QJsonObject &courseResponse) {
-                                                       handleCoursesResponse(courseResponse,
-                                                                             classItem);
-                                                   });
+            addCourses(classObj["courses"].toArray(), classItem);
+        }
+
+        QStringList topics;
+        for (const auto &val : classes) {
+            for (const auto &course : val.toObject()["courses"].toArray()) {
+                topics.append(QString("course:%1").arg(course.toObject()["course_id"].toInt()));
+            }
+        }
+        if (!topics.isEmpty()) {
+            NetworkManager::instance().subscribe(topics);
         }
     }
 }
 
-void CourseListWidget::handleCoursesResponse(const QJsonObject &response, QTreeWidgetItem *classItem)
+void CourseListWidget::addCourses(const QJsonArray &courses, QTreeWidgetItem *classItem)
 {
-    if (response["type"].toString() == "DATA_RESPONSE") {
-        QJsonArray courses = response["data"].toArray();
-        for (const auto &val : courses) {
-            QJsonObject courseObj = val.toObject();
-            auto *courseItem = new QTreeWidgetItem(classItem);
-            courseItem->setText(0, courseObj["course_name"].toString());
-            courseItem->setText(1, "course");
-
-            QJsonObject data;
-            data["course_id"] = courseObj["course_id"].toInt();
-            NetworkManager::instance().sendCommand("GET_MATERIALS_FOR_COURSE",
-                                                   data,
-                                                   [this, courseItem](
-                                                       const QJsonObject &materialResponse) {
-                                                       handleMaterialsResponse(materialResponse,
-                                                                               courseItem);
-                                                   });
+    for (const auto &val : courses) {
+        QJsonObject courseObj = val.toObject();
+        auto *courseItem = new QTreeWidgetItem(classItem);
+        courseItem->setText(0, courseObj["course_name"].toString());
+        courseItem->setText(1, "course");
+        courseItem->setText(2, QString::number(courseObj["course_id"].toInt()));
+
+        addMaterials(courseObj["materials"].toArray(), courseItem);
+    }
+}
+
+void CourseListWidget::addMaterials(const QJsonArray &materials, QTreeWidgetItem *courseItem)
+{
+    for (const auto &val : materials) {
+        QJsonObject materialObj = val.toObject();
+        auto *materialItem = new QTreeWidgetItem(courseItem);
+        materialItem->setText(0, materialObj["title"].toString());
+        materialItem->setText(1, materialObj["type"].toString());
+        materialItem->setText(2, QString::number(materialObj["material_id"].toInt()));
+        materialItem->setText(3, materialObj["instructor_name"].toString());
+    }
+}
+
+void CourseListWidget::syncMaterials(const QJsonArray &materials, QTreeWidgetItem *courseItem)
+{
+    // Only touch the items that changed, so the material being read stays selected
+    QSet<QString> ids;
+    QJsonArray added;
+    for (const auto &val : materials) {
+        QString id = QString::number(val.toObject()["material_id"].toInt());
+        ids.insert(id);
+        bool present = false;
+        for (int i = 0; i < courseItem->childCount() && !present; ++i) {
+            present = courseItem->child(i)->text(2) == id;
+        }
+        if (!present) {
+            added.append(val);
+        }
+    }
+
+    for (int i = courseItem->childCount() - 1; i >= 0; --i) {
+        if (!ids.contains(courseItem->child(i)->text(2))) {
+            delete courseItem->takeChild(i);
         }
     }
+    addMaterials(added, courseItem);
+    applyFilter();
 }
 
-void CourseListWidget::handleMaterialsResponse(const QJsonObject &response,
-                                               QTreeWidgetItem *courseItem)
+QTreeWidgetItem *CourseListWidget::findCourseItem(int courseId) const
 {
-    if (response["type"].toString() == "DATA_RESPONSE") {
-        QJsonArray materials = response["data"].toArray();
-        for (const auto &val : materials) {
-            QJsonObject materialObj = val.toObject();
-            auto *materialItem = new QTreeWidgetItem(courseItem);
-            materialItem->setText(0, materialObj["title"].toString());
-            materialItem->setText(1, materialObj["type"].toString());
-            materialItem->setText(2, QString::number(materialObj["material_id"].toInt()));
-            materialItem->setText(3, materialObj["instructor_name"].toString());
+    QString id = QString::number(courseId);
+    for (int i = 0; i < m_materialsTreeWidget->topLevelItemCount(); ++i) {
+        QTreeWidgetItem *classItem = m_materialsTreeWidget->topLevelItem(i);
+        for (int j = 0; j < classItem->childCount(); ++j) {
+            if (classItem->child(j)->text(2) == id) {
+                return classItem->child(j);
+            }
         }
     }
+    return nullptr;
+}
+
+void CourseListWidget::handleEvent(const QString &topic, const QJsonObject &)
+{
+    if (!topic.startsWith("course:"))
+        return;
+
+    // Fetch just this course's material list and merge it into the tree
+    int courseId = topic.mid(7).toInt();
+    QJsonObject data;
+    data["course_id"] = courseId;
+    NetworkManager::instance().sendCommand(
+        "GET_MATERIALS_FOR_COURSE", data, [this, courseId](const QJsonObject &response) {
+            QTreeWidgetItem *courseItem = findCourseItem(courseId);
+            if (courseItem && response["type"].toString() == "DATA_RESPONSE") {
+                syncMaterials(response["data"].toArray(), courseItem);
+            }
+        });
 }
 
 void CourseListWidget::handleQuizDataResponse(const QJsonObject &response)
@@ -285,11 +345,28 @@ void CourseListWidget::handleQuizSubmissionResponse(const QJsonObject &response)
     }
 }
 
-void CourseListWidget::displayTextLesson(const QJsonObject &lesson)
+void CourseListWidget::displayTextLesson(int materialId, const QString &title)
 {
-    m_contentGroup->setTitle(lesson["title"].toString());
-    m_lessonTextEdit->setPlainText(lesson["content"].toString());
+    m_contentGroup->setTitle(title);
     m_lessonTextEdit->show();
+
+    // Append the text chunk by chunk so the start of a long lesson shows up right away
+    int generation = m_contentGeneration;
+    NetworkManager::instance()
+        .streamLesson(materialId, [this, generation](const QJsonObject &response, bool) {
+            if (generation != m_contentGeneration || response["type"] != "DATA_RESPONSE") {
+                return false;
+            }
+            // A newer version than the cached copy on screen starts over from offset 0
+            QJsonObject chunk = response["data"].toObject();
+            if (chunk["offset"].toInteger() == 0) {
+                m_lessonTextEdit->clear();
+            }
+            QTextCursor cursor(m_lessonTextEdit->document());
+            cursor.movePosition(QTextCursor::End);
+            cursor.insertText(chunk["content"].toString());
+            return true;
+        });
 }
 
 void CourseListWidget::displayQuiz(const QJsonObject &quiz)
@@ -352,6 +429,7 @@ void CourseListWidget::displayQuiz(const QJsonObject &quiz)
 
 void CourseListWidget::clearContentArea()
 {
+    ++m_contentGeneration; // Stops a lesson that is still streaming in
     m_lessonTextEdit->clear();
     m_lessonTextEdit->hide();
     m_startQuizButton->hide();
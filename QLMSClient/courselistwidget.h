@@ -29,21 +29,25 @@ private slots:
     void onStartQuiz();
     void onSubmitQuiz();
     void handleClassesResponse(const QJsonObject &response);
-    void handleCoursesResponse(const QJsonObject &response, QTreeWidgetItem *classItem);
-    void handleMaterialsResponse(const QJsonObject &response, QTreeWidgetItem *courseItem);
     void handleQuizDataResponse(const QJsonObject &response);
     void handleQuizSubmissionResponse(const QJsonObject &response);
     void applyFilter();
+    void handleEvent(const QString &topic, const QJsonObject &event);
 
 private:
+    void addCourses(const QJsonArray &courses, QTreeWidgetItem *classItem);
+    void addMaterials(const QJsonArray &materials, QTreeWidgetItem *courseItem);
+    void syncMaterials(const QJsonArray &materials, QTreeWidgetItem *courseItem);
+    QTreeWidgetItem *findCourseItem(int courseId) const;
     void setupUi();
-    void displayTextLesson(const QJsonObject &lesson);
+    void displayTextLesson(int materialId, const QString &title);
     void displayQuiz(const QJsonObject &quiz);
     void clearContentArea();
     bool applyFilterRecursive(QTreeWidgetItem *item, const QString &text, const QString &filterBy);
 
     int m_studentId;
     QJsonObject m_currentQuiz;
+    int m_contentGeneration = 0;
 
     // UI Elements
     FilterWidget *m_materialsFilterWidget;
@@ -7,7 +7,9 @@
 #include <QLabel>
 #include <QMessageBox>
 #include <QPushButton>
+#include <QSignalBlocker>
 #include <QSplitter>
+#include <QTextCursor>
 #include <QTextEdit>
 #include <QTreeWidget>
 #include <QTreeWidgetItem>
@@ -85,23 +87,11 @@ void CourseManagementWidget::setupUi()
 
 void CourseManagementWidget::onRefresh()
 {
-    // Disconnect the signal to prevent onItemSelected from being called during the refresh
-    disconnect(m_materialsTreeWidget,
-               &QTreeWidget::itemSelectionChanged,
-               this,
-               &CourseManagementWidget::onItemSelected);
-
-    m_materialsTreeWidget->clear();
-    NetworkManager::instance().sendCommand("GET_ALL_CLASSES",
-                                           QJsonObject(),
-                                           [this](const QJsonObject &response) {
-                                               handleClassesResponse(response);
-                                               // Reconnect the signal now that the tree is populated
-                                               connect(m_materialsTreeWidget,
-                                                       &QTreeWidget::itemSelectionChanged,
-                                                       this,
-                                                       &CourseManagementWidget::onItemSelected);
-                                           });
+    NetworkManager::instance().sendCached("GET_CLASS_TREE",
+                                          QJsonObject(),
+                                          [this](const QJsonObject &response) {
+                                              handleClassesResponse(response);
+                                          });
 }
 
 void CourseManagementWidget::onItemSelected()
@@ -114,18 +104,22 @@ void CourseManagementWidget::onItemSelected()
 
     QString type = item->text(1);
     m_deleteButton->setEnabled(type == "lesson" || type == "quiz");
+    clearContentArea();
 
-    if (type == "lesson" || type == "quiz") {
+    if (type == "lesson") {
+        displayLesson(item->text(2).toInt(), item->text(0));
+    } else if (type == "quiz") {
         int materialId = item->text(2).toInt();
         QJsonObject data;
         data["material_id"] = materialId;
-        NetworkManager::instance().sendCommand("GET_MATERIAL_DETAILS",
-                                               data,
-                                               [this](const QJsonObject &response) {
-                                                   handleMaterialDetailsResponse(response);
-                                               });
-    } else {
-        clearContentArea();
+        int generation = m_contentGeneration;
+        NetworkManager::instance().sendCached("GET_MATERIAL_DETAILS",
+                                              data,
+                                              [this, generation](const QJsonObject &response) {
+                                                  if (generation == m_contentGeneration) {
+                                                      handleMaterialDetailsResponse(response);
+                                                  }
+                                              });
     }
 }
 
@@ -168,6 +162,10 @@ void CourseManagementWidget::onAddMaterial()
 void CourseManagementWidget::handleClassesResponse(const QJsonObject &response)
 {
     if (response["type"].toString() == "DATA_RESPONSE") {
+        // Also called again when the cached tree turns out to be stale. Rebuilding the tree
+        // must not trigger onItemSelected.
+        QSignalBlocker blocker(m_materialsTreeWidget);
+        m_materialsTreeWidget->clear();
         QJsonArray classes = response["data"].toArray();
         for (const auto &val : classes) {
             QJsonObject classObj = val.toObject();
@@ -176,56 +174,32 @@ void CourseManagementWidget::handleClassesResponse(const QJsonObject &response)
             classItem->setText(1, "class");
             classItem->setText(2, QString::number(classObj["class_id"].toInt()));
 
-            QJsonObject data;
-            data["class_id"] = classObj["class_id"].toInt();
-            NetworkManager::instance().sendCommand("GET_COURSES_FOR_CLASS",
-                                                   data,
-                                                   [this,
-                                                    classItem](const QJsonObject &courseResponse) {
-                                                       handleCoursesResponse(courseResponse,
-                                                                             classItem);
-                                                   });
+            addCourses(classObj["courses"].toArray(), classItem);
         }
     }
 }
 
-void CourseManagementWidget::handleCoursesResponse(const QJsonObject &response,
-                                                   QTreeWidgetItem *classItem)
+void CourseManagementWidget::addCourses(const QJsonArray &courses, QTreeWidgetItem *classItem)
 {
-    if (response["type"].toString() == "DATA_RESPONSE") {
-        QJsonArray courses = response["data"].toArray();
-        for (const auto &val : courses) {
-            QJsonObject courseObj = val.toObject();
-            auto *courseItem = new QTreeWidgetItem(classItem);
-            courseItem->setText(0, courseObj["course_name"].toString());
-            courseItem->setText(1, "course");
-            courseItem->setText(2, QString::number(courseObj["course_id"].toInt()));
-
-            QJsonObject data;
-            data["course_id"] = courseObj["course_id"].toInt();
-            NetworkManager::instance().sendCommand("GET_MATERIALS_FOR_COURSE",
-                                                   data,
-                                                   [this, courseItem](
-                                                       const QJsonObject &materialResponse) {
-                                                       handleMaterialsResponse(materialResponse,
-                                                                               courseItem);
-                                                   });
-        }
+    for (const auto &val : courses) {
+        QJsonObject courseObj = val.toObject();
+        auto *courseItem = new QTreeWidgetItem(classItem);
+        courseItem->setText(0, courseObj["course_name"].toString());
+        courseItem->setText(1, "course");
+        courseItem->setText(2, QString::number(courseObj["course_id"].toInt()));
+
+        addMaterials(courseObj["materials"].toArray(), courseItem);
     }
 }
 
-void CourseManagementWidget::handleMaterialsResponse(const QJsonObject &response,
-                                                     QTreeWidgetItem *courseItem)
+void CourseManagementWidget::addMaterials(const QJsonArray &materials, QTreeWidgetItem *courseItem)
 {
-    if (response["type"].toString() == "DATA_RESPONSE") {
-        QJsonArray materials = response["data"].toArray();
-        for (const auto &val : materials) {
-            QJsonObject materialObj = val.toObject();
-            auto *materialItem = new QTreeWidgetItem(courseItem);
-            materialItem->setText(0, materialObj["title"].toString());
-            materialItem->setText(1, materialObj["type"].toString());
-            materialItem->setText(2, QString::number(materialObj["material_id"].toInt()));
-        }
+    for (const auto &val : materials) {
+        QJsonObject materialObj = val.toObject();
+        auto *materialItem = new QTreeWidgetItem(courseItem);
+        materialItem->setText(0, materialObj["title"].toString());
+        materialItem->setText(1, materialObj["type"].toString());
+        materialItem->setText(2, QString::number(materialObj["material_id"].toInt()));
     }
 }
 
@@ -235,9 +209,7 @@ void CourseManagementWidget::handleMaterialDetailsResponse(const QJsonObject &re
         QJsonObject material = response["data"].toObject();
         QString type = material["type"].toString();
 
-        if (type == "lesson") {
-            displayLesson(material);
-        } else if (type == "quiz") {
+        if (type == "quiz") {
             displayQuiz(material);
         }
     } else {
@@ -260,10 +232,33 @@ void CourseManagementWidget::handleDeleteMaterialResponse(const QJsonObject &res
     }
 }
 
-void CourseManagementWidget::displayLesson(const QJsonObject &lesson)
+void CourseManagementWidget::displayLesson(int materialId, const QString &title)
 {
-    m_contentGroup->setTitle(lesson["title"].toString());
-    m_contentView->setPlainText(lesson["content"].toString());
+    m_contentGroup->setTitle(title);
+
+    // Append the text chunk by chunk so the start of a long lesson shows up right away
+    int generation = m_contentGeneration;
+    NetworkManager::instance()
+        .streamLesson(materialId, [this, generation](const QJsonObject &response, bool) {
+            if (generation != m_contentGeneration) {
+                return false;
+            }
+            if (response["type"].toString() != "DATA_RESPONSE") {
+                QMessageBox::critical(this,
+                                      "Error",
+                                      response["message"].toString("Failed to load the lesson"));
+                return false;
+            }
+            // A newer version than the cached copy on screen starts over from offset 0
+            QJsonObject chunk = response["data"].toObject();
+            if (chunk["offset"].toInteger() == 0) {
+                m_contentView->clear();
+            }
+            QTextCursor cursor(m_contentView->document());
+            cursor.movePosition(QTextCursor::End);
+            cursor.insertText(chunk["content"].toString());
+            return true;
+        });
 }
 
 void CourseManagementWidget::displayQuiz(const QJsonObject &quiz)
@@ -298,6 +293,7 @@ void CourseManagementWidget::displayQuiz(const QJsonObject &quiz)
 
 void CourseManagementWidget::clearContentArea()
 {
+    ++m_contentGeneration; // Stops a lesson that is still streaming in
     m_contentGroup->setTitle("Select a material to view its content");
     m_contentView->clear();
 }
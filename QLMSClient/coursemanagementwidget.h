@@ -27,14 +27,14 @@ private slots:
     void onDeleteMaterial();
     void onAddMaterial();
     void handleClassesResponse(const QJsonObject &response);
-    void handleCoursesResponse(const QJsonObject &response, QTreeWidgetItem *classItem);
-    void handleMaterialsResponse(const QJsonObject &response, QTreeWidgetItem *courseItem);
     void handleMaterialDetailsResponse(const QJsonObject &response);
     void handleDeleteMaterialResponse(const QJsonObject &response);
 
 private:
+    void addCourses(const QJsonArray &courses, QTreeWidgetItem *classItem);
+    void addMaterials(const QJsonArray &materials, QTreeWidgetItem *courseItem);
     void setupUi();
-    void displayLesson(const QJsonObject &lesson);
+    void displayLesson(int materialId, const QString &title);
     void displayQuiz(const QJsonObject &quiz);
     void clearContentArea();
 
@@ -46,6 +46,7 @@ private:
     QGroupBox *m_contentGroup;
     QVBoxLayout *m_contentLayout;
     QTextEdit *m_contentView;
+    int m_contentGeneration = 0;
 };
 
 #endif // COURSEMANAGEMENTWIDGET_H
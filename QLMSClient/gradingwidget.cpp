@@ -16,6 +16,19 @@ GradingWidget::GradingWidget(QWidget *parent)
     : QWidget(parent)
 {
     setupUi();
+
+    // New submissions and grades from other sessions arrive as events instead of by polling
+    connect(&NetworkManager::instance(),
+            &NetworkManager::eventReceived,
+            this,
+            &GradingWidget::handleEvent);
+    NetworkManager::instance().subscribe({"pending_attempts"});
+    // Catch up on events missed while the connection was down
+    connect(&NetworkManager::instance(),
+            &NetworkManager::sessionResumed,
+            this,
+            &GradingWidget::onRefreshPendingAttempts);
+
     onRefreshPendingAttempts();
 }
 
@@ -157,11 +170,20 @@ void GradingWidget::updateScoreInfo(int row)
 
 void GradingWidget::onRefreshPendingAttempts()
 {
-    NetworkManager::instance().sendCommand("GET_PENDING_ATTEMPTS",
-                                           QJsonObject(),
-                                           [this](const QJsonObject &response) {
-                                               handlePendingAttemptsResponse(response);
-                                           });
+    // Rows are appended page by page; a newer refresh abandons the pages of an older one
+    int generation = ++m_refreshGeneration;
+    m_pendingAttempts = QJsonArray();
+    m_attemptsTable->setRowCount(0);
+
+    NetworkManager::instance().sendPaged("GET_PENDING_ATTEMPTS",
+                                         QJsonObject(),
+                                         [this, generation](const QJsonObject &response, bool) {
+                                             if (generation != m_refreshGeneration) {
+                                                 return false;
+                                             }
+                                             handlePendingAttemptsResponse(response);
+                                             return true;
+                                         });
 }
 
 void GradingWidget::onSubmitGrade()
@@ -185,11 +207,11 @@ void GradingWidget::onSubmitGrade()
         data["question_id"] = questionId;
         data["score"] = m_scoreSpinBox->value();
 
-        NetworkManager::instance()
-            .sendCommand("SUBMIT_GRADE", data, [this](const QJsonObject &response) {
+        NetworkManager::instance().sendCommand(
+            "SUBMIT_GRADE", data, [this, attemptId, questionId](const QJsonObject &response) {
                 if (response["type"].toString() == "OK") {
                     QMessageBox::information(this, "Success", "Grade submitted successfully");
-                    onRefreshPendingAttempts();
+                    removePendingAnswer(attemptId, questionId);
                     m_scoreInfoLabel->clear();
                     m_questionAnswerTextEdit->clear();
                 } else {
@@ -202,18 +224,48 @@ void GradingWidget::onSubmitGrade()
 void GradingWidget::handlePendingAttemptsResponse(const QJsonObject &response)
 {
     if (response["type"].toString() == "DATA_RESPONSE") {
-        m_pendingAttempts = response["data"].toArray();
-        populateAttemptsTable(m_pendingAttempts);
+        QJsonArray attempts = response["data"].toArray();
+        for (const QJsonValue &attempt : attempts) {
+            m_pendingAttempts.append(attempt);
+        }
+        populateAttemptsTable(attempts);
     } else {
         QMessageBox::critical(this, "Error", "Failed to fetch pending attempts");
     }
 }
 
-void GradingWidget::populateAttemptsTable(const QJsonArray &attempts)
+void GradingWidget::handleEvent(const QString &topic, const QJsonObject &event)
 {
-    m_attemptsTable->setRowCount(0);
+    if (topic != "pending_attempts")
+        return;
+
+    QString type = event["event"].toString();
+    if (type == "answer_graded") {
+        removePendingAnswer(event["attempt_id"].toInt(), event["question_id"].toInt());
+    } else if (type == "attempt_submitted") {
+        onRefreshPendingAttempts();
+    }
+}
+
+void GradingWidget::removePendingAnswer(int attemptId, int questionId)
+{
+    for (int row = m_pendingAttempts.size() - 1; row >= 0; --row) {
+        QJsonObject attempt = m_pendingAttempts[row].toObject();
+        if (attempt["attempt_id"].toInt() == attemptId
+            && attempt["question_id"].toInt() == questionId) {
+            m_pendingAttempts.removeAt(row);
+            m_attemptsTable->removeRow(row);
+        }
+    }
 
-    int questionCounter = 0;
+    // Keep the question numbers contiguous
+    for (int row = 0; row < m_attemptsTable->rowCount(); ++row) {
+        m_attemptsTable->item(row, 8)->setText(QString::number(row + 1));
+    }
+}
+
+void GradingWidget::populateAttemptsTable(const QJsonArray &attempts)
+{
     for (const QJsonValue &value : attempts) {
         QJsonObject attempt = value.toObject();
         int row = m_attemptsTable->rowCount();
@@ -240,7 +292,7 @@ void GradingWidget::populateAttemptsTable(const QJsonArray &attempts)
                                  7,
                                  new QTableWidgetItem(QString("%1%").arg(autoScore, 0, 'f', 1)));
 
-        m_attemptsTable->setItem(row, 8, new QTableWidgetItem(QString::number(++questionCounter)));
+        m_attemptsTable->setItem(row, 8, new QTableWidgetItem(QString::number(row + 1)));
         m_attemptsTable->setItem(row, 9, new QTableWidgetItem("Pending"));
     }
 }
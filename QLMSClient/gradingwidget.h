@@ -23,11 +23,13 @@ private slots:
     void onRefreshPendingAttempts();
     void onSubmitGrade();
     void handlePendingAttemptsResponse(const QJsonObject &response);
+    void handleEvent(const QString &topic, const QJsonObject &event);
 
 private:
     void setupUi();
-    void populateAttemptsTable(const QJsonArray &attempts);
+    void populateAttemptsTable(const QJsonArray &attempts); // Appends to the rows already shown
     void updateScoreInfo(int row);
+    void removePendingAnswer(int attemptId, int questionId);
 
     QTableWidget *m_attemptsTable;
     QPushButton *m_refreshButton;
@@ -36,6 +38,7 @@ private:
     QLabel *m_scoreInfoLabel;
     QTextEdit *m_questionAnswerTextEdit;
     QJsonArray m_pendingAttempts;
+    int m_refreshGeneration = 0;
 };
 
 #endif // GRADINGWIDGET_H
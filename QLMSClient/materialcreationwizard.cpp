@@ -117,7 +117,7 @@ CourseSelectPage::CourseSelectPage(QWidget *parent)
 void CourseSelectPage::initializePage()
 {
     NetworkManager::instance()
-        .sendCommand("GET_ALL_CLASSES", QJsonObject(), [this](const QJsonObject &response) {
+        .sendCached("GET_ALL_CLASSES", QJsonObject(), [this](const QJsonObject &response) {
             if (response["type"].toString() == "DATA_RESPONSE") {
                 m_classes = response["data"].toArray();
                 m_classCombo->clear();
@@ -154,7 +154,7 @@ void CourseSelectPage::onClassSelected(int index)
     data["class_id"] = classId;
 
     NetworkManager::instance()
-        .sendCommand("GET_COURSES_FOR_CLASS", data, [this](const QJsonObject &response) {
+        .sendCached("GET_COURSES_FOR_CLASS", data, [this](const QJsonObject &response) {
             if (response["type"].toString() == "DATA_RESPONSE") {
                 QJsonArray courses = response["data"].toArray();
                 m_courseCombo->clear();
@@ -1,7 +1,14 @@
 #include "networkmanager.h"
+#include <algorithm>
+#include <memory>
+#include <QDeadlineTimer>
 #include <QDebug>
+#include <QJsonArray>
 #include <QJsonDocument>
+#include <QMap>
+#include <QRandomGenerator>
 #include <QSslConfiguration>
+#include <QTimer>
 
 NetworkManager &NetworkManager::instance()
 {
@@ -9,8 +16,22 @@ NetworkManager &NetworkManager::instance()
     return instance;
 }
 
+// Responses can carry whole course materials, so allow more than the server accepts
+static constexpr qsizetype MaxResponseSize = 64 * 1024 * 1024;
+
+// Requests are mostly small; this only catches lessons and quizzes being uploaded
+static constexpr qsizetype CompressionThreshold = 4096;
+
+// Whole lessons, kept next to the sendCached() responses
+static QString lessonCacheKey(int materialId)
+{
+    return QString("LESSON %1").arg(materialId);
+}
+
 NetworkManager::NetworkManager()
     : m_socket(new QSslSocket(this))
+    , m_codec(MaxResponseSize)
+    , m_reconnectTimer(new QTimer(this))
 {
     // Configure SSL settings before any connection
     QSslConfiguration sslConfig = m_socket->sslConfiguration();
@@ -27,6 +48,9 @@ NetworkManager::NetworkManager()
             QOverload<QAbstractSocket::SocketError>::of(&QAbstractSocket::errorOccurred),
             this,
             &NetworkManager::onSocketError);
+
+    m_reconnectTimer->setSingleShot(true);
+    connect(m_reconnectTimer, &QTimer::timeout, this, &NetworkManager::reconnect);
 }
 
 NetworkManager::~NetworkManager()
@@ -44,7 +68,12 @@ bool NetworkManager::connectToServer(const QString &host, quint16 port)
     qDebug() << "Attempting to connect to" << host << ":" << port;
 
     // Clear any previous errors
-    m_buffer.clear();
+    m_codec.clear();
+    m_sendOrder.clear();
+    m_serverEchoesRequestIds = false;
+    m_host = host;
+    m_port = port;
+    m_serverName = QString("%1:%2").arg(host).arg(port);
 
     // Start encrypted connection
     m_socket->connectToHostEncrypted(host, port);
@@ -65,21 +94,70 @@ bool NetworkManager::connectToServer(const QString &host, quint16 port)
     }
 
     qDebug() << "SSL handshake completed successfully";
+
+    negotiateFormat();
     return true;
 }
 
+void NetworkManager::negotiateFormat(std::function<void()> then)
+{
+    // Nothing else may be sent until the answer arrives, since the server switches formats
+    // right after replying. Servers without HELLO answer with an error and we stay on JSON.
+    static constexpr int NegotiationTimeout = 5000;
+
+    auto answered = std::make_shared<bool>(false);
+    QJsonObject data;
+    data["formats"] = QJsonArray{MessageCodec::formatName(MessageCodec::Format::Cbor),
+                                 MessageCodec::formatName(MessageCodec::Format::Json)};
+    data["compression"] = QJsonArray{"zlib"};
+
+    sendCommand(
+        "HELLO",
+        data,
+        [this, answered, then](const QJsonObject &response) {
+            *answered = true;
+            MessageCodec::Format format;
+            if (response["type"].toString() == "OK"
+                && MessageCodec::formatFromName(response["format"].toString(), &format)) {
+                m_codec.setFormat(format);
+                if (response["compression"].toString() == "zlib") {
+                    m_codec.setCompressionThreshold(CompressionThreshold);
+                }
+            }
+            qDebug() << "Using" << MessageCodec::formatName(m_codec.format()) << "messages,"
+                     << "compression threshold" << m_codec.compressionThreshold();
+            if (then) {
+                then();
+            }
+        },
+        NegotiationTimeout);
+
+    if (then) {
+        return;
+    }
+
+    QDeadlineTimer deadline(NegotiationTimeout);
+    while (!*answered && isConnected() && m_socket->waitForReadyRead(deadline.remainingTime())) {
+    }
+}
+
 void NetworkManager::disconnectFromServer()
 {
+    // A deliberate disconnect drops outstanding requests without reporting errors, and ends
+    // the session for good
+    clearPendingRequests();
+    m_reconnectTimer->stop();
+    m_reconnecting = false;
+    m_sessionToken.clear();
+    m_subscriptions.clear();
+
     if (m_socket->state() != QAbstractSocket::UnconnectedState) {
         m_socket->disconnectFromHost();
         if (m_socket->state() != QAbstractSocket::UnconnectedState) {
             m_socket->waitForDisconnected(5000);
         }
     }
-    m_buffer.clear();
-    while (!m_callbacks.isEmpty()) {
-        m_callbacks.dequeue();
-    }
+    m_codec.clear();
 }
 
 bool NetworkManager::isConnected() const
@@ -89,7 +167,8 @@ bool NetworkManager::isConnected() const
 
 void NetworkManager::sendCommand(const QString &command,
                                  const QJsonObject &data,
-                                 std::function<void(const QJsonObject &)> callback)
+                                 std::function<void(const QJsonObject &)> callback,
+                                 int timeoutMs)
 {
     if (!isConnected()) {
         qWarning() << "Cannot send command: not connected or not encrypted";
@@ -101,18 +180,358 @@ void NetworkManager::sendCommand(const QString &command,
         }
         return;
     }
+    // Until the session is back, the server would treat commands as coming from a stranger
+    if (m_reconnecting && command != "HELLO" && command != "RESUME_SESSION") {
+        if (callback) {
+            QJsonObject error;
+            error["type"] = "ERROR";
+            error["message"] = "Reconnecting to server";
+            callback(error);
+        }
+        return;
+    }
+
+    quint64 requestId = m_nextRequestId++;
 
     QJsonObject message;
     message["command"] = command;
     message["data"] = data;
+    message["request_id"] = static_cast<double>(requestId);
+
+    // Cached responses and the session token belong to the user who is logged in
+    if (command == "LOGIN" || command == "LOGOUT") {
+        m_responseCache.close();
+        m_sessionToken.clear();
+        m_subscriptions.clear();
+    }
+    if (command == "LOGIN") {
+        callback = [this, callback](const QJsonObject &response) {
+            if (response["type"].toString() == "LOGIN_SUCCESS") {
+                openResponseCache(response["user"].toObject()["user_id"].toInt());
+                m_sessionToken = response["session_token"].toString();
+            }
+            if (callback) {
+                callback(response);
+            }
+        };
+    }
 
-    if (callback) {
-        m_callbacks.enqueue(callback);
+    // Commands without a callback are tracked too, so their responses can't be mistaken for
+    // the answer to a later command
+    PendingRequest request;
+    request.command = command;
+    request.message = message;
+    request.callback = std::move(callback);
+    if (timeoutMs > 0) {
+        request.timer = new QTimer(this);
+        request.timer->setSingleShot(true);
+        connect(request.timer, &QTimer::timeout, this, [this, requestId]() {
+            qWarning() << "Request" << requestId << "timed out";
+            QJsonObject error;
+            error["type"] = "ERROR";
+            error["message"] = "The server did not respond in time";
+            completeRequest(requestId, error);
+        });
+        request.timer->start(timeoutMs);
+    }
+    m_pendingRequests.insert(requestId, request);
+    if (!m_serverEchoesRequestIds) {
+        m_sendOrder.enqueue(requestId);
     }
 
     sendMessage(message);
 }
 
+void NetworkManager::sendBatch(const QList<BatchCommand> &commands,
+                               std::function<void(const QList<QJsonObject> &)> callback)
+{
+    if (commands.isEmpty()) {
+        callback({});
+        return;
+    }
+
+    QJsonArray entries;
+    for (const BatchCommand &command : commands) {
+        QJsonObject entry;
+        entry["command"] = command.command;
+        entry["data"] = command.data;
+        entries.append(entry);
+    }
+
+    QJsonObject data;
+    data["commands"] = entries;
+
+    sendCommand("BATCH", data, [this, commands, callback](const QJsonObject &response) {
+        if (response["type"].toString() == "DATA_RESPONSE") {
+            const QJsonArray results = response["data"].toArray();
+            QList<QJsonObject> responses;
+            responses.reserve(commands.size());
+            for (const QJsonValue &result : results) {
+                responses.append(result.toObject());
+            }
+            responses.resize(commands.size());
+            callback(responses);
+        } else if (response["message"].toString() == "Unknown command") {
+            sendSeparately(commands, callback);
+        } else {
+            callback(QList<QJsonObject>(commands.size(), response));
+        }
+    });
+}
+
+void NetworkManager::sendCached(const QString &command,
+                                const QJsonObject &data,
+                                std::function<void(const QJsonObject &)> callback,
+                                int timeoutMs)
+{
+    // QJsonObject keeps its keys sorted, so equal requests give equal keys
+    QString key = command + ' ' + QJsonDocument(data).toJson(QJsonDocument::Compact);
+    QJsonObject request = data;
+    qint64 version;
+    QJsonObject cached;
+    bool haveCached = m_responseCache.lookup(key, &version, &cached);
+    if (haveCached) {
+        request["if_version"] = version;
+        callback(cached);
+    }
+
+    auto onResponse = [this, key, haveCached, callback](const QJsonObject &response) {
+        QString type = response["type"].toString();
+        if (type == "NOT_MODIFIED") {
+            return;
+        }
+        if (type != "DATA_RESPONSE" && haveCached) {
+            qWarning() << "Keeping cached" << key << "after error:"
+                       << response["message"].toString();
+            return;
+        }
+        if (type == "DATA_RESPONSE" && response.contains("version")) {
+            m_responseCache.store(key, response["version"].toInteger(), response);
+        } else {
+            m_responseCache.remove(key);
+        }
+        callback(response);
+    };
+    sendCommand(command, request, onResponse, timeoutMs);
+}
+
+void NetworkManager::openResponseCache(int userId)
+{
+    QString scope = QString("%1/%2").arg(m_serverName).arg(userId);
+    if (!m_responseCache.open(scope)) {
+        qWarning() << "Continuing without the response cache";
+    }
+}
+
+void NetworkManager::sendPaged(const QString &command,
+                               const QJsonObject &data,
+                               std::function<bool(const QJsonObject &, bool)> pageCallback,
+                               int pageSize)
+{
+    QJsonObject request = data;
+    request["limit"] = pageSize;
+
+    auto onPage = [this, command, request, pageCallback](const QJsonObject &response) {
+        QString nextCursor = response["next_cursor"].toString();
+        bool more = response["type"].toString() == "DATA_RESPONSE" && !nextCursor.isEmpty();
+        if (!pageCallback(response, more) || !more) {
+            return;
+        }
+
+        QJsonObject next = request;
+        next["cursor"] = nextCursor;
+        sendPaged(command, next, pageCallback, next["limit"].toInt());
+    };
+    sendCommand(command, request, onPage);
+}
+
+void NetworkManager::sendPagedAll(const QString &command,
+                                  const QJsonObject &data,
+                                  std::function<void(const QJsonObject &)> callback)
+{
+    auto rows = std::make_shared<QJsonArray>();
+    sendPaged(command, data, [rows, callback](const QJsonObject &response, bool more) {
+        if (response["type"].toString() != "DATA_RESPONSE") {
+            callback(response);
+            return false;
+        }
+
+        for (const QJsonValue &row : response["data"].toArray()) {
+            rows->append(row);
+        }
+        if (!more) {
+            QJsonObject combined;
+            combined["type"] = "DATA_RESPONSE";
+            combined["data"] = *rows;
+            callback(combined);
+        }
+        return true;
+    });
+}
+
+struct NetworkManager::LessonStream
+{
+    int materialId;
+    int chunkSize;
+    std::function<bool(const QJsonObject &, bool)> callback;
+    qint64 requested = 0; // Offset of the next chunk to request
+    qint64 delivered = 0; // Offset of the next chunk to hand to the callback
+    QMap<qint64, QJsonObject> arrived; // Chunks that overtook an earlier one
+    bool finished = false;
+    qint64 cachedVersion = -1; // Version of the kept copy already delivered, if any
+    qint64 version = -1;       // Stamp of the first chunk; -1 while unknown or not kept
+    QString text;              // Delivered so far, kept once the lesson is complete
+};
+
+void NetworkManager::streamLesson(int materialId,
+                                  std::function<bool(const QJsonObject &, bool)> chunkCallback,
+                                  int chunkSize)
+{
+    auto stream = std::make_shared<LessonStream>();
+    stream->materialId = materialId;
+    stream->chunkSize = chunkSize;
+    stream->callback = std::move(chunkCallback);
+
+    QJsonObject cached;
+    if (m_responseCache.lookup(lessonCacheKey(materialId), &stream->cachedVersion, &cached)
+        && !stream->callback(cached, false)) {
+        return;
+    }
+
+    // The first chunk goes out alone so short lessons cost one round trip
+    requestLessonChunk(stream);
+}
+
+void NetworkManager::requestLessonChunk(const std::shared_ptr<LessonStream> &stream)
+{
+    qint64 offset = stream->requested;
+    stream->requested += stream->chunkSize;
+
+    QJsonObject data;
+    data["material_id"] = stream->materialId;
+    data["offset"] = offset;
+    data["length"] = stream->chunkSize;
+    if (offset == 0 && stream->cachedVersion >= 0) {
+        data["if_version"] = stream->cachedVersion;
+    }
+    sendCommand("GET_LESSON_CHUNK", data, [this, stream, offset](const QJsonObject &response) {
+        handleLessonChunk(stream, offset, response);
+    });
+}
+
+void NetworkManager::handleLessonChunk(const std::shared_ptr<LessonStream> &stream,
+                                       qint64 offset,
+                                       const QJsonObject &response)
+{
+    if (stream->finished) {
+        return;
+    }
+    if (response["type"].toString() != "DATA_RESPONSE") {
+        // The kept copy stays up when it's current or the server can't be reached
+        stream->finished = true;
+        if (response["type"].toString() != "NOT_MODIFIED" && stream->cachedVersion < 0) {
+            stream->callback(response, false);
+        }
+        return;
+    }
+
+    // Pipelined requests may complete out of order; deliver them by offset
+    stream->arrived.insert(offset, response);
+    while (!stream->finished && stream->arrived.contains(stream->delivered)) {
+        QJsonObject chunk = stream->arrived.take(stream->delivered);
+        stream->delivered += stream->chunkSize;
+        bool more = !chunk["data"].toObject()["done"].toBool();
+        keepLessonChunk(stream, chunk, more);
+        if (!stream->callback(chunk, more) || !more) {
+            stream->finished = true;
+        }
+    }
+
+    while (!stream->finished
+           && stream->requested - stream->delivered < qint64(ChunkWindow) * stream->chunkSize) {
+        requestLessonChunk(stream);
+    }
+}
+
+void NetworkManager::keepLessonChunk(const std::shared_ptr<LessonStream> &stream,
+                                     const QJsonObject &chunk,
+                                     bool more)
+{
+    QJsonObject data = chunk["data"].toObject();
+    if (data["offset"].toInteger() == 0) {
+        stream->version = chunk["version"].toInteger(-1);
+    }
+    if (stream->version < 0) {
+        return;
+    }
+
+    stream->text += data["content"].toString();
+    // Every UTF-16 unit takes at least a byte once encoded, so the cache would refuse the lesson
+    if (!m_responseCache.isOpen() || stream->text.size() > m_responseCache.maxEntryBytes()) {
+        m_responseCache.remove(lessonCacheKey(stream->materialId));
+        stream->version = -1;
+        stream->text = QString();
+        return;
+    }
+    if (more) {
+        return;
+    }
+
+    // Handed back as one final chunk holding the whole text
+    data["offset"] = 0;
+    data["content"] = stream->text;
+    QJsonObject response = chunk;
+    response["data"] = data;
+    m_responseCache.store(lessonCacheKey(stream->materialId), stream->version, response);
+    stream->text.clear();
+}
+
+void NetworkManager::subscribe(const QStringList &topics)
+{
+    for (const QString &topic : topics) {
+        if (!m_subscriptions.contains(topic)) {
+            m_subscriptions.append(topic);
+        }
+    }
+    sendSubscribe(topics);
+}
+
+void NetworkManager::sendSubscribe(const QStringList &topics)
+{
+    QJsonObject data;
+    data["topics"] = QJsonArray::fromStringList(topics);
+    sendCommand("SUBSCRIBE", data, [topics](const QJsonObject &response) {
+        if (response["type"].toString() != "OK") {
+            qWarning() << "Failed to subscribe to" << topics << ":"
+                       << response["message"].toString();
+        }
+    });
+}
+
+void NetworkManager::sendSeparately(const QList<BatchCommand> &commands,
+                                    std::function<void(const QList<QJsonObject> &)> callback)
+{
+    struct State
+    {
+        QList<QJsonObject> responses;
+        qsizetype remaining;
+    };
+    auto state = std::make_shared<State>();
+    state->responses.resize(commands.size());
+    state->remaining = commands.size();
+
+    for (qsizetype i = 0; i < commands.size(); ++i) {
+        sendCommand(commands[i].command,
+                    commands[i].data,
+                    [state, i, callback](const QJsonObject &response) {
+                        state->responses[i] = response;
+                        if (--state->remaining == 0) {
+                            callback(state->responses);
+                        }
+                    });
+    }
+}
+
 void NetworkManager::onConnected()
 {
     qDebug() << "TCP connection established";
@@ -122,31 +541,118 @@ void NetworkManager::onConnected()
 void NetworkManager::onEncrypted()
 {
     qDebug() << "SSL connection encrypted";
+    if (m_reconnecting) {
+        negotiateFormat([this]() { resumeSession(); });
+        return;
+    }
     emit connected();
 }
 
 void NetworkManager::onDisconnected()
 {
     qDebug() << "Disconnected from server";
-    m_buffer.clear();
+    m_codec.clear();
+    failPendingRequests("Connection to server lost");
+
+    if (!m_sessionToken.isEmpty()) {
+        if (!m_reconnecting) {
+            m_reconnecting = true;
+            m_reconnectAttempts = 0;
+            emit reconnecting();
+        }
+        scheduleReconnect();
+        return;
+    }
     emit disconnected();
 }
 
-void NetworkManager::onReadyRead()
+void NetworkManager::scheduleReconnect()
 {
-    m_buffer.append(m_socket->readAll());
+    if (m_reconnectTimer->isActive()) {
+        return;
+    }
+    if (m_reconnectAttempts >= MaxReconnectAttempts) {
+        qWarning() << "Giving up reconnecting after" << m_reconnectAttempts << "attempts";
+        abandonSession();
+        return;
+    }
 
-    int pos;
-    while ((pos = m_buffer.indexOf('\n')) != -1) {
-        QByteArray messageData = m_buffer.left(pos);
-        m_buffer.remove(0, pos + 1);
+    // Spread clients out so an access point handoff doesn't bring them all back at once
+    int delay = qMin(MaxReconnectDelay, 1000 << m_reconnectAttempts);
+    delay = delay / 2 + QRandomGenerator::global()->bounded(delay / 2 + 1);
+    ++m_reconnectAttempts;
+    qDebug() << "Reconnecting in" << delay << "ms";
+    m_reconnectTimer->start(delay);
+}
 
-        QJsonDocument doc = QJsonDocument::fromJson(messageData);
-        if (!doc.isNull() && doc.isObject()) {
-            processMessage(doc.object());
-        } else {
-            qWarning() << "Received invalid JSON message:" << messageData;
+void NetworkManager::reconnect()
+{
+    if (m_socket->state() != QAbstractSocket::UnconnectedState) {
+        m_socket->abort();
+    }
+    m_codec.clear();
+    m_sendOrder.clear();
+    m_serverEchoesRequestIds = false;
+    m_socket->connectToHostEncrypted(m_host, m_port);
+
+    QTimer::singleShot(ReconnectTimeout, this, [this, attempt = m_reconnectAttempts]() {
+        if (m_reconnecting && attempt == m_reconnectAttempts && !isConnected()) {
+            qWarning() << "Reconnect attempt" << attempt << "timed out";
+            m_socket->abort();
+            scheduleReconnect();
         }
+    });
+}
+
+void NetworkManager::resumeSession()
+{
+    QJsonObject data;
+    data["session_token"] = m_sessionToken;
+    sendCommand("RESUME_SESSION", data, [this](const QJsonObject &response) {
+        if (response["type"].toString() == "LOGIN_SUCCESS") {
+            qDebug() << "Session resumed";
+            m_sessionToken = response["session_token"].toString(m_sessionToken);
+            m_reconnecting = false;
+            if (!m_subscriptions.isEmpty()) {
+                sendSubscribe(m_subscriptions);
+            }
+            emit sessionResumed();
+        } else if (isConnected()) {
+            qWarning() << "Could not resume session:" << response["message"].toString();
+            abandonSession();
+        }
+        // Otherwise the connection dropped again and the next attempt is already scheduled
+    });
+}
+
+void NetworkManager::abandonSession()
+{
+    bool wasConnected = m_socket->state() != QAbstractSocket::UnconnectedState;
+    disconnectFromServer();
+    // Disconnecting a live socket already reported it
+    if (!wasConnected) {
+        emit disconnected();
+    }
+}
+
+void NetworkManager::onReadyRead()
+{
+    if (m_codec.frameTooLarge())
+        return;
+
+    m_codec.append(m_socket->readAll());
+
+    // A HELLO reply switches the format mid-loop; later frames are decoded in the new format
+    QJsonObject message;
+    while (m_codec.nextMessage(message)) {
+        processMessage(message);
+    }
+
+    if (m_codec.frameTooLarge()) {
+        qCritical() << "Server message exceeds" << m_codec.maxFrameSize()
+                    << "bytes, disconnecting";
+        emit errorOccurred("Received an oversized message from the server");
+        m_socket->abort();
     }
 }
 
@@ -165,6 +671,14 @@ void NetworkManager::onSocketError(QAbstractSocket::SocketError error)
     QString errorString = m_socket->errorString();
     qCritical() << "Socket error:" << error << "-" << errorString;
 
+    // A logged in client reconnects on its own; onDisconnected() covers dropped connections
+    if (!m_sessionToken.isEmpty()) {
+        if (m_reconnecting && m_socket->state() == QAbstractSocket::UnconnectedState) {
+            scheduleReconnect();
+        }
+        return;
+    }
+
     // Provide more specific error messages
     QString userMessage;
     switch (error) {
@@ -197,15 +711,89 @@ void NetworkManager::processMessage(const QJsonObject &message)
 
     emit messageReceived(message);
 
-    // Call registered callback if available
-    if (!m_callbacks.isEmpty()) {
-        auto callback = m_callbacks.dequeue();
-        if (callback) {
-            callback(message);
+    // Pushed by the server for a subscription, never an answer to a command
+    if (message["type"].toString() == "EVENT") {
+        emit eventReceived(message["topic"].toString(), message["data"].toObject());
+        return;
+    }
+
+    if (message.contains("request_id")) {
+        if (!m_serverEchoesRequestIds) {
+            m_serverEchoesRequestIds = true;
+            m_sendOrder.clear();
         }
+        completeRequest(static_cast<quint64>(message["request_id"].toInteger()), message);
+        return;
+    }
+
+    // Servers that echo request ids send nothing else untagged in reply to a command.
+    // Older servers answer strictly in order; a request that already timed out still takes
+    // its turn so the late response is dropped instead of going to the next callback.
+    if (!m_serverEchoesRequestIds && !m_sendOrder.isEmpty()) {
+        completeRequest(m_sendOrder.dequeue(), message);
     }
 }
 
+void NetworkManager::completeRequest(quint64 requestId, const QJsonObject &response)
+{
+    auto it = m_pendingRequests.find(requestId);
+    if (it == m_pendingRequests.end()) {
+        qDebug() << "Dropping response for unknown or expired request" << requestId;
+        return;
+    }
+
+    if (response["type"].toString() == "BUSY" && it->busyRetries < MaxBusyRetries) {
+        ++it->busyRetries;
+        int delay = qBound(0, response["retry_after_ms"].toInt(), MaxBusyDelay);
+        QTimer::singleShot(delay, this, [this, requestId]() {
+            // The request may have timed out or been failed by a disconnect meanwhile
+            auto pending = m_pendingRequests.constFind(requestId);
+            if (pending != m_pendingRequests.constEnd() && isConnected()) {
+                sendMessage(pending->message);
+            }
+        });
+        return;
+    }
+
+    PendingRequest request = std::move(it.value());
+    m_pendingRequests.erase(it);
+    if (request.timer) {
+        request.timer->stop();
+        request.timer->deleteLater();
+    }
+
+    if (request.callback) {
+        request.callback(response);
+    }
+}
+
+void NetworkManager::failPendingRequests(const QString &error)
+{
+    // Fail in send order; callbacks may issue new commands, which are kept out of this pass
+    QList<quint64> requestIds = m_pendingRequests.keys();
+    std::sort(requestIds.begin(), requestIds.end());
+    m_sendOrder.clear();
+
+    QJsonObject response;
+    response["type"] = "ERROR";
+    response["message"] = error;
+    for (quint64 requestId : requestIds) {
+        completeRequest(requestId, response);
+    }
+}
+
+void NetworkManager::clearPendingRequests()
+{
+    for (const PendingRequest &request : std::as_const(m_pendingRequests)) {
+        if (request.timer) {
+            request.timer->stop();
+            request.timer->deleteLater();
+        }
+    }
+    m_pendingRequests.clear();
+    m_sendOrder.clear();
+}
+
 void NetworkManager::sendMessage(const QJsonObject &message)
 {
     if (!isConnected()) {
@@ -213,12 +801,10 @@ void NetworkManager::sendMessage(const QJsonObject &message)
         return;
     }
 
-    QJsonDocument doc(message);
-    QByteArray data = doc.toJson(QJsonDocument::Compact) + "\n";
-
-    qDebug() << "Sending message:" << doc.toJson(QJsonDocument::Indented).constData();
+    qDebug() << "Sending message:"
+             << QJsonDocument(message).toJson(QJsonDocument::Indented).constData();
 
-    qint64 written = m_socket->write(data);
+    qint64 written = m_socket->write(m_codec.encode(message));
     if (written == -1) {
         qWarning() << "Failed to write to socket:" << m_socket->errorString();
     } else {
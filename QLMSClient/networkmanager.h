@@ -1,11 +1,18 @@
 #ifndef NETWORKMANAGER_H
 #define NETWORKMANAGER_H
 
+#include "messagecodec.h"
+#include "responsecache.h"
 #include <functional>
+#include <memory>
+#include <QHash>
 #include <QJsonObject>
 #include <QObject>
 #include <QQueue>
 #include <QSslSocket>
+#include <QStringList>
+
+class QTimer;
 
 class NetworkManager : public QObject
 {
@@ -18,24 +25,134 @@ public:
     void disconnectFromServer();
     bool isConnected() const;
 
+    // Milliseconds a command may wait for its response before the callback gets an error
+    static constexpr int DefaultRequestTimeout = 30000;
+
+    // Every command is tagged with a request_id, so responses may arrive in any order.
+    // A timeout of 0 or less waits for the response as long as the connection stays up.
     void sendCommand(const QString& command,
                      const QJsonObject& data,
-                     std::function<void(const QJsonObject&)> callback = nullptr);
+                     std::function<void(const QJsonObject&)> callback = nullptr,
+                     int timeoutMs = DefaultRequestTimeout);
+
+    struct BatchCommand
+    {
+        QString command;
+        QJsonObject data;
+    };
+
+    // Sends the commands as one BATCH request. The callback receives one response per command,
+    // in order; if the batch itself fails, each entry holds that error. Falls back to separate
+    // commands when the server doesn't know BATCH. The server refuses session commands and
+    // critical ones such as FINISH_ATTEMPT inside a batch; send those with sendCommand().
+    void sendBatch(const QList<BatchCommand>& commands,
+                   std::function<void(const QList<QJsonObject>&)> callback);
+
+    // Sends a command whose responses the server version-stamps: GET_MATERIAL_DETAILS,
+    // GET_ALL_CLASSES, GET_COURSES_FOR_CLASS, GET_MATERIALS_FOR_COURSE and GET_CLASS_TREE.
+    // Responses are kept on disk for the logged in user. A kept response goes to the callback
+    // right away and is then revalidated with if_version; the callback runs a second time only
+    // if the server has newer data. Errors are not reported while a kept copy is on screen.
+    void sendCached(const QString& command,
+                    const QJsonObject& data,
+                    std::function<void(const QJsonObject&)> callback,
+                    int timeoutMs = DefaultRequestTimeout);
+
+    // Rows requested per page of a list command; the server caps it at 500
+    static constexpr int DefaultPageSize = 100;
+
+    // Fetches a list command page by page, following the server's next_cursor. The callback
+    // gets each page (or the error) with more = true while another page follows, and returns
+    // false to stop fetching.
+    void sendPaged(const QString& command,
+                   const QJsonObject& data,
+                   std::function<bool(const QJsonObject&, bool more)> pageCallback,
+                   int pageSize = DefaultPageSize);
+
+    // Fetches every page and hands the callback one DATA_RESPONSE holding all rows
+    void sendPagedAll(const QString& command,
+                      const QJsonObject& data,
+                      std::function<void(const QJsonObject&)> callback);
+
+    // Characters per lesson chunk, and how many chunk requests may be in flight at once
+    static constexpr int DefaultChunkSize = 16384;
+    static constexpr int ChunkWindow = 4;
+
+    // Streams a lesson's text with GET_LESSON_CHUNK. The callback gets the chunks in order
+    // (or the error) with more = true while another chunk follows, and returns false to stop.
+    // At most ChunkWindow chunks are requested ahead of the one being delivered. A lesson
+    // streamed to the end is kept like sendCached() responses: it arrives at once as a single
+    // chunk, and if the server has a newer version, that is streamed again from offset 0.
+    void streamLesson(int materialId,
+                      std::function<bool(const QJsonObject&, bool more)> chunkCallback,
+                      int chunkSize = DefaultChunkSize);
+
+    // Asks the server to push change events for the topics: "pending_attempts" (instructors),
+    // "grades" (students) or "course:<id>". Events arrive through eventReceived(). The
+    // subscriptions are renewed when a session is resumed.
+    void subscribe(const QStringList& topics);
+
+    // When a logged in connection drops, reconnect() is retried with growing, randomized
+    // delays and the session is restored with RESUME_SESSION instead of LOGIN. disconnected()
+    // is only emitted once that fails.
+    static constexpr int MaxReconnectAttempts = 8;
+    static constexpr int MaxReconnectDelay = 30000;
+    static constexpr int ReconnectTimeout = 15000; // Per attempt, TLS handshake included
+
+    // A command the server answers with BUSY is sent again after the delay it asks for, within
+    // the command's timeout. The callback only sees BUSY once the retries are used up.
+    static constexpr int MaxBusyRetries = 3;
+    static constexpr int MaxBusyDelay = 5000;
 
 signals:
     void connected();
     void disconnected();
+    void reconnecting();
+    void sessionResumed(); // Events sent while the connection was down are lost
     void messageReceived(const QJsonObject& message);
+    void eventReceived(const QString& topic, const QJsonObject& event);
     void errorOccurred(const QString& error);
 
 private:
     NetworkManager();
     ~NetworkManager();
 
+    struct PendingRequest
+    {
+        QString command;
+        QJsonObject message; // Sent again when the server is busy
+        std::function<void(const QJsonObject&)> callback;
+        QTimer* timer = nullptr;
+        int busyRetries = 0;
+    };
+
+    struct LessonStream;
+
+    // Without a continuation, blocks until the server has answered
+    void negotiateFormat(std::function<void()> then = nullptr);
+    void scheduleReconnect();
+    void resumeSession();
+    void sendSubscribe(const QStringList& topics);
+    void abandonSession();
+    void openResponseCache(int userId);
+    void requestLessonChunk(const std::shared_ptr<LessonStream>& stream);
+    void handleLessonChunk(const std::shared_ptr<LessonStream>& stream,
+                           qint64 offset,
+                           const QJsonObject& response);
+    // Collects the delivered chunks and caches the lesson once the last one has arrived
+    void keepLessonChunk(const std::shared_ptr<LessonStream>& stream,
+                         const QJsonObject& chunk,
+                         bool more);
+    void sendSeparately(const QList<BatchCommand>& commands,
+                        std::function<void(const QList<QJsonObject>&)> callback);
     void sendMessage(const QJsonObject& message);
     void processMessage(const QJsonObject& message);
+    void completeRequest(quint64 requestId, const QJsonObject& response);
+    void failPendingRequests(const QString& error);
+    void clearPendingRequests();
 
 private slots:
+    void reconnect();
     void onConnected();
     void onEncrypted(); // Added this slot
     void onDisconnected();
@@ -45,8 +162,20 @@ private slots:
 
 private:
     QSslSocket* m_socket;
-    QByteArray m_buffer;
-    QQueue<std::function<void(const QJsonObject&)>> m_callbacks;
+    MessageCodec m_codec;
+    QHash<quint64, PendingRequest> m_pendingRequests;
+    QQueue<quint64> m_sendOrder; // Matches responses from servers that don't echo request_id
+    quint64 m_nextRequestId = 1;
+    bool m_serverEchoesRequestIds = false;
+    QString m_host;
+    quint16 m_port = 0;
+    QString m_serverName; // host:port, part of the response cache scope
+    QString m_sessionToken;
+    QStringList m_subscriptions;
+    QTimer* m_reconnectTimer;
+    int m_reconnectAttempts = 0;
+    bool m_reconnecting = false; // Until RESUME_SESSION has been answered
+    ResponseCache m_responseCache;
 };
 
 #endif // NETWORKMANAGER_H
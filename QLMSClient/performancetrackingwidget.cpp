@@ -10,6 +10,7 @@
 #include <QSplitter>
 #include <QTextEdit>
 #include <QTreeWidgetItem>
+#include <QTreeWidgetItemIterator>
 #include <QVBoxLayout>
 
 PerformanceTrackingWidget::PerformanceTrackingWidget(int instructorId, QWidget *parent)
@@ -82,12 +83,11 @@ void PerformanceTrackingWidget::setupUi()
 
 void PerformanceTrackingWidget::onRefresh()
 {
-    m_treeWidget->clear();
-    NetworkManager::instance().sendCommand("GET_ALL_CLASSES",
-                                           QJsonObject(),
-                                           [this](const QJsonObject &response) {
-                                               handleClassesResponse(response);
-                                           });
+    NetworkManager::instance().sendCached("GET_CLASS_TREE",
+                                          QJsonObject(),
+                                          [this](const QJsonObject &response) {
+                                              handleClassesResponse(response);
+                                          });
 }
 
 void PerformanceTrackingWidget::onItemSelected()
@@ -137,29 +137,26 @@ void PerformanceTrackingWidget::onItemSelected()
         int quizId = item->data(4, Qt::UserRole).toInt();
         QJsonObject data;
         data["quiz_id"] = quizId;
-        NetworkManager::instance().sendCommand(
-            "GET_STUDENT_ATTEMPTS_FOR_QUIZ", data, [this, item](const QJsonObject &response) {
-                if (response["type"] == "DATA_RESPONSE") {
-                    qDeleteAll(item->takeChildren());
-                    QJsonArray attempts = response["data"].toArray();
-                    for (const auto &val : attempts) {
-                        QJsonObject attempt = val.toObject();
-                        auto *attemptItem = new QTreeWidgetItem(item);
-                        QString scoreText = attempt["final_score"].isNull()
-                                                ? "Pending"
-                                                : QString::number(attempt["final_score"].toDouble(),
-                                                                  'f',
-                                                                  1)
-                                                      + "%";
-                        attemptItem->setText(0, attempt["student_name"].toString());
-                        attemptItem->setText(1, scoreText);
-                        attemptItem->setText(2, QString::number(attempt["attempt_number"].toInt()));
-                        attemptItem->setText(3, "attempt");
-                        attemptItem->setData(4, Qt::UserRole, attempt["attempt_id"].toInt());
-                    }
-                    item->setExpanded(true);
-                }
-            });
+
+        // Attempts are appended page by page; selecting another quiz or rebuilding the tree
+        // abandons the pages still loading. Pages find the quiz by id rather than holding on to
+        // an item the tree owns.
+        int generation = ++m_attemptsGeneration;
+        qDeleteAll(item->takeChildren());
+        item->setExpanded(true);
+
+        auto onPage = [this, quizId, generation](const QJsonObject &response, bool) {
+            if (generation != m_attemptsGeneration || response["type"] != "DATA_RESPONSE") {
+                return false;
+            }
+            QTreeWidgetItem *quizItem = findQuizItem(quizId);
+            if (!quizItem) {
+                return false;
+            }
+            addAttempts(response["data"].toArray(), quizItem);
+            return true;
+        };
+        NetworkManager::instance().sendPaged("GET_STUDENT_ATTEMPTS_FOR_QUIZ", data, onPage);
     } else if (type == "attempt") {
         int attemptId = item->data(4, Qt::UserRole).toInt();
         QJsonObject data;
@@ -175,6 +172,9 @@ void PerformanceTrackingWidget::onItemSelected()
 void PerformanceTrackingWidget::handleClassesResponse(const QJsonObject &response)
 {
     if (response["type"].toString() == "DATA_RESPONSE") {
+        // Also called again when the cached tree turns out to be stale
+        ++m_attemptsGeneration;
+        m_treeWidget->clear();
         QJsonArray classes = response["data"].toArray();
         for (const auto &val : classes) {
             QJsonObject classObj = val.toObject();
@@ -183,59 +183,62 @@ void PerformanceTrackingWidget::handleClassesResponse(const QJsonObject &respons
             classItem->setText(3, "class");
             classItem->setData(4, Qt::UserRole, classObj["class_id"].toInt());
 
-            QJsonObject data;
-            data["class_id"] = classObj["class_id"].toInt();
-            NetworkManager::instance().sendCommand("GET_COURSES_FOR_CLASS",
-                                                   data,
-                                                   [this,
-                                                    classItem](const QJsonObject &courseResponse) {
-                                                       handleCoursesResponse(courseResponse,
-                                                                             classItem);
-                                                   });
+            addCourses(classObj["courses"].toArray(), classItem);
         }
     }
 }
 
-void PerformanceTrackingWidget::handleCoursesResponse(const QJsonObject &response,
-                                                      QTreeWidgetItem *classItem)
+void PerformanceTrackingWidget::addCourses(const QJsonArray &courses, QTreeWidgetItem *classItem)
 {
-    if (response["type"].toString() == "DATA_RESPONSE") {
-        QJsonArray courses = response["data"].toArray();
-        for (const auto &val : courses) {
-            QJsonObject courseObj = val.toObject();
-            auto *courseItem = new QTreeWidgetItem(classItem);
-            courseItem->setText(0, courseObj["course_name"].toString());
-            courseItem->setText(3, "course");
-            courseItem->setData(4, Qt::UserRole, courseObj["course_id"].toInt());
-
-            QJsonObject data;
-            data["course_id"] = courseObj["course_id"].toInt();
-            NetworkManager::instance().sendCommand("GET_MATERIALS_FOR_COURSE",
-                                                   data,
-                                                   [this, courseItem](
-                                                       const QJsonObject &materialResponse) {
-                                                       handleMaterialsResponse(materialResponse,
-                                                                               courseItem);
-                                                   });
+    for (const auto &val : courses) {
+        QJsonObject courseObj = val.toObject();
+        auto *courseItem = new QTreeWidgetItem(classItem);
+        courseItem->setText(0, courseObj["course_name"].toString());
+        courseItem->setText(3, "course");
+        courseItem->setData(4, Qt::UserRole, courseObj["course_id"].toInt());
+
+        addMaterials(courseObj["materials"].toArray(), courseItem);
+    }
+}
+
+void PerformanceTrackingWidget::addMaterials(const QJsonArray &materials,
+                                             QTreeWidgetItem *courseItem)
+{
+    for (const auto &val : materials) {
+        QJsonObject materialObj = val.toObject();
+        if (materialObj["type"].toString() == "quiz") {
+            auto *materialItem = new QTreeWidgetItem(courseItem);
+            materialItem->setText(0, materialObj["title"].toString());
+            materialItem->setText(3, "quiz");
+            materialItem->setData(4, Qt::UserRole, materialObj["material_id"].toInt());
         }
     }
 }
 
-void PerformanceTrackingWidget::handleMaterialsResponse(const QJsonObject &response,
-                                                        QTreeWidgetItem *courseItem)
+void PerformanceTrackingWidget::addAttempts(const QJsonArray &attempts, QTreeWidgetItem *quizItem)
 {
-    if (response["type"].toString() == "DATA_RESPONSE") {
-        QJsonArray materials = response["data"].toArray();
-        for (const auto &val : materials) {
-            QJsonObject materialObj = val.toObject();
-            if (materialObj["type"].toString() == "quiz") {
-                auto *materialItem = new QTreeWidgetItem(courseItem);
-                materialItem->setText(0, materialObj["title"].toString());
-                materialItem->setText(3, "quiz");
-                materialItem->setData(4, Qt::UserRole, materialObj["material_id"].toInt());
-            }
+    for (const auto &val : attempts) {
+        QJsonObject attempt = val.toObject();
+        auto *attemptItem = new QTreeWidgetItem(quizItem);
+        QString scoreText = attempt["final_score"].isNull()
+                                ? "Pending"
+                                : QString::number(attempt["final_score"].toDouble(), 'f', 1) + "%";
+        attemptItem->setText(0, attempt["student_name"].toString());
+        attemptItem->setText(1, scoreText);
+        attemptItem->setText(2, QString::number(attempt["attempt_number"].toInt()));
+        attemptItem->setText(3, "attempt");
+        attemptItem->setData(4, Qt::UserRole, attempt["attempt_id"].toInt());
+    }
+}
+
+QTreeWidgetItem *PerformanceTrackingWidget::findQuizItem(int quizId) const
+{
+    for (QTreeWidgetItemIterator it(m_treeWidget); *it; ++it) {
+        if ((*it)->text(3) == "quiz" && (*it)->data(4, Qt::UserRole).toInt() == quizId) {
+            return *it;
         }
     }
+    return nullptr;
 }
 
 void PerformanceTrackingWidget::handleAttemptDetailsResponse(const QJsonObject &response)
@@ -26,18 +26,21 @@ private slots:
     void onRefresh();
     void onItemSelected();
     void handleClassesResponse(const QJsonObject &response);
-    void handleCoursesResponse(const QJsonObject &response, QTreeWidgetItem *classItem);
-    void handleMaterialsResponse(const QJsonObject &response, QTreeWidgetItem *courseItem);
     void handleAttemptDetailsResponse(const QJsonObject &response);
     void applyFilter();
 
 private:
+    void addCourses(const QJsonArray &courses, QTreeWidgetItem *classItem);
+    void addMaterials(const QJsonArray &materials, QTreeWidgetItem *courseItem);
+    void addAttempts(const QJsonArray &attempts, QTreeWidgetItem *quizItem);
+    QTreeWidgetItem *findQuizItem(int quizId) const;
     void setupUi();
     void displayAttemptDetails(const QJsonObject &attemptData);
     void clearDetailsArea();
     bool applyFilterRecursive(QTreeWidgetItem *item, const QString &text, const QString &filterBy);
 
     int m_instructorId;
+    int m_attemptsGeneration = 0;
 
     // UI Elements
     FilterWidget *m_filterWidget;
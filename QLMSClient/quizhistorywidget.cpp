@@ -17,6 +17,19 @@ QuizHistoryWidget::QuizHistoryWidget(int studentId, QWidget *parent)
     , m_studentId(studentId)
 {
     setupUi();
+
+    // Grades arrive as events, so there is no need to refresh while waiting for one
+    connect(&NetworkManager::instance(),
+            &NetworkManager::eventReceived,
+            this,
+            &QuizHistoryWidget::handleEvent);
+    NetworkManager::instance().subscribe({"grades"});
+    // Catch up on events missed while the connection was down
+    connect(&NetworkManager::instance(),
+            &NetworkManager::sessionResumed,
+            this,
+            &QuizHistoryWidget::onRefresh);
+
     onRefresh();
 }
 
@@ -83,14 +96,52 @@ void QuizHistoryWidget::setupUi()
 
 void QuizHistoryWidget::onRefresh()
 {
-    NetworkManager::instance().sendCommand("GET_MY_ATTEMPTS",
-                                           QJsonObject(),
-                                           [this](const QJsonObject &response) {
-                                               if (response["type"] == "DATA_RESPONSE") {
-                                                   m_allAttempts = response["data"].toArray();
-                                                   populateAttemptsList();
-                                               }
-                                           });
+    // Each page only adds and filters its own rows; a newer refresh abandons the older one's pages
+    int generation = ++m_refreshGeneration;
+    m_allAttempts = QJsonArray();
+    populateAttemptsList();
+
+    auto onPage = [this, generation](const QJsonObject &response, bool more) {
+        if (generation != m_refreshGeneration || response["type"] != "DATA_RESPONSE") {
+            return false;
+        }
+        QJsonArray attempts = response["data"].toArray();
+        for (const auto &val : attempts) {
+            m_allAttempts.append(val);
+        }
+        for (QTreeWidgetItem *quizItem : addAttempts(attempts)) {
+            applyFilterToQuiz(quizItem);
+        }
+        if (!more) {
+            resizeColumns();
+        }
+        return true;
+    };
+    NetworkManager::instance().sendPaged("GET_MY_ATTEMPTS", QJsonObject(), onPage);
+}
+
+void QuizHistoryWidget::handleEvent(const QString &topic, const QJsonObject &event)
+{
+    if (topic != "grades")
+        return;
+
+    if (event["event"].toString() == "attempt_graded") {
+        int attemptId = event["attempt_id"].toInt();
+        for (qsizetype i = 0; i < m_allAttempts.size(); ++i) {
+            QJsonObject attempt = m_allAttempts[i].toObject();
+            if (attempt["attempt_id"].toInt() == attemptId) {
+                attempt["status"] = event["status"];
+                attempt["final_score"] = event["final_score"];
+                m_allAttempts[i] = attempt;
+                populateAttemptsList();
+                applyFilter();
+                return;
+            }
+        }
+    }
+
+    // A new attempt, or one this list hasn't loaded
+    onRefresh();
 }
 
 void QuizHistoryWidget::onAttemptSelected()
@@ -177,35 +228,48 @@ void QuizHistoryWidget::displayAttemptDetails(const QJsonObject &attemptData)
 void QuizHistoryWidget::populateAttemptsList()
 {
     m_attemptsTreeWidget->clear();
-    QMap<int, QTreeWidgetItem *> classItems;
-    QMap<int, QTreeWidgetItem *> courseItems;
-    QMap<int, QTreeWidgetItem *> quizItems;
+    m_classItems.clear();
+    m_courseItems.clear();
+    m_quizItems.clear();
+
+    addAttempts(m_allAttempts);
+    resizeColumns();
+}
 
-    for (const auto &val : m_allAttempts) {
+QList<QTreeWidgetItem *> QuizHistoryWidget::addAttempts(const QJsonArray &attempts)
+{
+    QList<QTreeWidgetItem *> touched;
+    for (const auto &val : attempts) {
         QJsonObject attempt = val.toObject();
         int classId = attempt["class_id"].toInt();
-        if (!classItems.contains(classId)) {
+        if (!m_classItems.contains(classId)) {
             auto *classItem = new QTreeWidgetItem(m_attemptsTreeWidget);
             classItem->setText(0, attempt["class_name"].toString());
-            classItems[classId] = classItem;
+            classItem->setExpanded(true);
+            m_classItems[classId] = classItem;
         }
 
         int courseId = attempt["course_id"].toInt();
-        if (!courseItems.contains(courseId)) {
-            auto *courseItem = new QTreeWidgetItem(classItems[classId]);
+        if (!m_courseItems.contains(courseId)) {
+            auto *courseItem = new QTreeWidgetItem(m_classItems[classId]);
             courseItem->setText(0, attempt["course_name"].toString());
-            courseItems[courseId] = courseItem;
+            courseItem->setExpanded(true);
+            m_courseItems[courseId] = courseItem;
         }
 
         int quizId = attempt["quiz_id"].toInt();
-        if (!quizItems.contains(quizId)) {
-            auto *quizItem = new QTreeWidgetItem(courseItems[courseId]);
+        if (!m_quizItems.contains(quizId)) {
+            auto *quizItem = new QTreeWidgetItem(m_courseItems[courseId]);
             quizItem->setText(0, attempt["quiz_title"].toString());
             quizItem->setText(4, attempt["instructor_name"].toString());
-            quizItems[quizId] = quizItem;
+            quizItem->setExpanded(true);
+            m_quizItems[quizId] = quizItem;
+        }
+        if (!touched.contains(m_quizItems[quizId])) {
+            touched.append(m_quizItems[quizId]);
         }
 
-        auto *attemptItem = new QTreeWidgetItem(quizItems[quizId]);
+        auto *attemptItem = new QTreeWidgetItem(m_quizItems[quizId]);
         QString statusText = (attempt["status"].toString() == "completed") ? "Graded" : "Pending";
         QString scoreText = "N/A";
         if (!attempt["final_score"].isNull()) {
@@ -217,7 +281,11 @@ void QuizHistoryWidget::populateAttemptsList()
         attemptItem->setText(2, statusText);
         attemptItem->setText(3, QString::number(attempt["attempt_id"].toInt()));
     }
-    m_attemptsTreeWidget->expandAll();
+    return touched;
+}
+
+void QuizHistoryWidget::resizeColumns()
+{
     for (int i = 0; i < m_attemptsTreeWidget->columnCount(); ++i) {
         m_attemptsTreeWidget->resizeColumnToContents(i);
     }
@@ -232,6 +300,23 @@ void QuizHistoryWidget::applyFilter()
     }
 }
 
+void QuizHistoryWidget::applyFilterToQuiz(QTreeWidgetItem *quizItem)
+{
+    QString text = m_attemptsFilterWidget->filterText();
+    QString filterBy = m_attemptsFilterWidget->currentFilterOption();
+    applyFilterRecursive(quizItem, text, filterBy);
+
+    // An ancestor stays visible if it matches itself or any of its children is visible
+    int column = (filterBy == "Name") ? 0 : 4;
+    for (QTreeWidgetItem *item = quizItem->parent(); item; item = item->parent()) {
+        bool visible = item->text(column).contains(text, Qt::CaseInsensitive);
+        for (int i = 0; !visible && i < item->childCount(); ++i) {
+            visible = !item->child(i)->isHidden();
+        }
+        item->setHidden(!visible);
+    }
+}
+
 bool QuizHistoryWidget::applyFilterRecursive(QTreeWidgetItem *item,
                                              const QString &text,
                                              const QString &filterBy)
@@ -3,6 +3,7 @@
 
 #include <QJsonArray>
 #include <QJsonObject>
+#include <QMap>
 #include <QWidget>
 
 QT_BEGIN_NAMESPACE
@@ -28,15 +29,25 @@ private slots:
     void onAttemptSelected();
     void handleAttemptDetailsResponse(const QJsonObject &response);
     void applyFilter();
+    void handleEvent(const QString &topic, const QJsonObject &event);
 
 private:
     void setupUi();
     void displayAttemptDetails(const QJsonObject &attemptData);
     void populateAttemptsList();
+    // Adds attempts under their class, course and quiz items and returns the quiz items touched
+    QList<QTreeWidgetItem *> addAttempts(const QJsonArray &attempts);
+    void resizeColumns();
+    // Filters the attempts of one quiz and updates its ancestors, leaving the rest of the tree
+    void applyFilterToQuiz(QTreeWidgetItem *quizItem);
     bool applyFilterRecursive(QTreeWidgetItem *item, const QString &text, const QString &filterBy);
 
     int m_studentId;
     QJsonArray m_allAttempts;
+    int m_refreshGeneration = 0;
+    QMap<int, QTreeWidgetItem *> m_classItems;
+    QMap<int, QTreeWidgetItem *> m_courseItems;
+    QMap<int, QTreeWidgetItem *> m_quizItems;
 
     // UI Elements
     FilterWidget *m_attemptsFilterWidget;
@@ -0,0 +1,192 @@
+#include "responsecache.h"
+#include <QCborMap>
+#include <QCborValue>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QStandardPaths>
+
+static const char ConnectionName[] = "QLMSResponseCache";
+
+ResponseCache::ResponseCache() {}
+
+ResponseCache::~ResponseCache()
+{
+    close();
+}
+
+bool ResponseCache::open(const QString &scope, qint64 maxBytes)
+{
+    close();
+
+    QString directory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (directory.isEmpty() || !QDir().mkpath(directory)) {
+        qWarning() << "No cache directory, responses will not be cached";
+        return false;
+    }
+
+    QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", ConnectionName);
+    db.setDatabaseName(QDir(directory).filePath("responses.sqlite"));
+    if (!db.open()) {
+        qWarning() << "Failed to open response cache:" << db.lastError().text();
+        db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(ConnectionName);
+        return false;
+    }
+
+    QSqlQuery query(db);
+    query.exec("PRAGMA journal_mode = WAL");
+    query.exec("PRAGMA synchronous = NORMAL");
+    if (!query.exec("CREATE TABLE IF NOT EXISTS responses ("
+                    "scope TEXT NOT NULL, key TEXT NOT NULL, version INTEGER NOT NULL, "
+                    "payload BLOB NOT NULL, size INTEGER NOT NULL, last_used INTEGER NOT NULL, "
+                    "PRIMARY KEY (scope, key))")
+        || !query.exec("CREATE INDEX IF NOT EXISTS idx_responses_last_used "
+                       "ON responses(last_used)")
+        || !query.exec("SELECT COALESCE(SUM(size), 0) FROM responses") || !query.next()) {
+        qWarning() << "Failed to prepare response cache:" << query.lastError().text();
+        query = QSqlQuery();
+        db.close();
+        db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(ConnectionName);
+        return false;
+    }
+
+    m_scope = scope;
+    m_maxBytes = maxBytes;
+    m_totalBytes = query.value(0).toLongLong();
+    evict(); // The limit may have shrunk since the file was written
+    return true;
+}
+
+void ResponseCache::close()
+{
+    if (m_scope.isEmpty())
+        return;
+
+    m_scope.clear();
+    QSqlDatabase::database(ConnectionName, false).close();
+    QSqlDatabase::removeDatabase(ConnectionName);
+}
+
+bool ResponseCache::isOpen() const
+{
+    return !m_scope.isEmpty();
+}
+
+bool ResponseCache::lookup(const QString &key, qint64 *version, QJsonObject *response)
+{
+    if (!isOpen())
+        return false;
+
+    QSqlDatabase db = QSqlDatabase::database(ConnectionName, false);
+    QSqlQuery query(db);
+    query.prepare("SELECT version, payload FROM responses WHERE scope = :scope AND key = :key");
+    query.bindValue(":scope", m_scope);
+    query.bindValue(":key", key);
+    if (!query.exec() || !query.next()) {
+        return false;
+    }
+
+    *version = query.value(0).toLongLong();
+    *response = QCborValue::fromCbor(query.value(1).toByteArray()).toMap().toJsonObject();
+
+    QSqlQuery touch(db);
+    touch.prepare("UPDATE responses SET last_used = :now WHERE scope = :scope AND key = :key");
+    touch.bindValue(":now", QDateTime::currentMSecsSinceEpoch());
+    touch.bindValue(":scope", m_scope);
+    touch.bindValue(":key", key);
+    touch.exec();
+    return true;
+}
+
+void ResponseCache::store(const QString &key, qint64 version, const QJsonObject &response)
+{
+    if (!isOpen())
+        return;
+
+    QByteArray payload = QCborMap::fromJsonObject(response).toCborValue().toCbor();
+    if (payload.size() > maxEntryBytes()) {
+        remove(key);
+        return;
+    }
+
+    QSqlDatabase db = QSqlDatabase::database(ConnectionName, false);
+    QSqlQuery query(db);
+    query.prepare("SELECT size FROM responses WHERE scope = :scope AND key = :key");
+    query.bindValue(":scope", m_scope);
+    query.bindValue(":key", key);
+    qint64 replaced = query.exec() && query.next() ? query.value(0).toLongLong() : 0;
+
+    query.prepare("INSERT OR REPLACE INTO responses (scope, key, version, payload, size, "
+                  "last_used) VALUES (:scope, :key, :version, :payload, :size, :now)");
+    query.bindValue(":scope", m_scope);
+    query.bindValue(":key", key);
+    query.bindValue(":version", version);
+    query.bindValue(":payload", payload);
+    query.bindValue(":size", payload.size());
+    query.bindValue(":now", QDateTime::currentMSecsSinceEpoch());
+    if (!query.exec()) {
+        qWarning() << "Failed to cache response:" << query.lastError().text();
+        return;
+    }
+
+    m_totalBytes += payload.size() - replaced;
+    evict();
+}
+
+void ResponseCache::remove(const QString &key)
+{
+    if (!isOpen())
+        return;
+
+    QSqlQuery query(QSqlDatabase::database(ConnectionName, false));
+    query.prepare("SELECT size FROM responses WHERE scope = :scope AND key = :key");
+    query.bindValue(":scope", m_scope);
+    query.bindValue(":key", key);
+    if (!query.exec() || !query.next()) {
+        return;
+    }
+    qint64 size = query.value(0).toLongLong();
+
+    query.prepare("DELETE FROM responses WHERE scope = :scope AND key = :key");
+    query.bindValue(":scope", m_scope);
+    query.bindValue(":key", key);
+    if (query.exec()) {
+        m_totalBytes -= size;
+    }
+}
+
+void ResponseCache::evict()
+{
+    QSqlDatabase db = QSqlDatabase::database(ConnectionName, false);
+    QSqlQuery oldest(db);
+    QSqlQuery drop(db);
+    drop.prepare("DELETE FROM responses WHERE scope = :scope AND key = :key");
+
+    // Oldest entries of any scope go first, a batch at a time
+    while (m_totalBytes > m_maxBytes) {
+        if (!oldest.exec("SELECT scope, key, size FROM responses ORDER BY last_used LIMIT 32")
+            || !oldest.next()) {
+            m_totalBytes = 0;
+            return;
+        }
+        bool dropped = false;
+        do {
+            drop.bindValue(":scope", oldest.value(0));
+            drop.bindValue(":key", oldest.value(1));
+            if (drop.exec()) {
+                m_totalBytes -= oldest.value(2).toLongLong();
+                dropped = true;
+            }
+        } while (m_totalBytes > m_maxBytes && oldest.next());
+
+        if (!dropped) {
+            qWarning() << "Failed to trim response cache:" << drop.lastError().text();
+            return;
+        }
+    }
+}
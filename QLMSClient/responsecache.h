@@ -0,0 +1,40 @@
+#ifndef RESPONSECACHE_H
+#define RESPONSECACHE_H
+
+#include <QJsonObject>
+#include <QString>
+
+// Versioned server responses kept in an SQLite file under the user's cache directory, so a new
+// session can show its materials before the server has answered. Entries belong to one server
+// and user (the scope); the file is shared by all scopes and trimmed least recently used first.
+class ResponseCache
+{
+public:
+    static constexpr qint64 DefaultMaxBytes = 64 * 1024 * 1024;
+
+    ResponseCache();
+    ~ResponseCache();
+
+    // Opening another scope closes the current one; lookups fail while no scope is open
+    bool open(const QString &scope, qint64 maxBytes = DefaultMaxBytes);
+    void close();
+    bool isOpen() const;
+
+    bool lookup(const QString &key, qint64 *version, QJsonObject *response);
+    // Larger responses are not kept, so one lesson can't push out everything else
+    qint64 maxEntryBytes() const { return m_maxBytes / 4; }
+    void store(const QString &key, qint64 version, const QJsonObject &response);
+    void remove(const QString &key);
+
+private:
+    ResponseCache(const ResponseCache &) = delete;
+    ResponseCache &operator=(const ResponseCache &) = delete;
+
+    void evict();
+
+    QString m_scope;
+    qint64 m_maxBytes = DefaultMaxBytes;
+    qint64 m_totalBytes = 0; // Payload bytes in the file, across all scopes
+};
+
+#endif // RESPONSECACHE_H
@@ -80,11 +80,19 @@ void UserManagementWidget::setupUi()
 
 void UserManagementWidget::onRefreshClicked()
 {
-    NetworkManager::instance().sendCommand("GET_ALL_USERS",
-                                           QJsonObject(),
-                                           [this](const QJsonObject &response) {
-                                               handleUsersResponse(response);
-                                           });
+    // Rows are appended page by page; a newer refresh abandons the pages of an older one
+    int generation = ++m_refreshGeneration;
+    m_tableWidget->setRowCount(0);
+
+    NetworkManager::instance().sendPaged("GET_ALL_USERS",
+                                         QJsonObject(),
+                                         [this, generation](const QJsonObject &response, bool) {
+                                             if (generation != m_refreshGeneration) {
+                                                 return false;
+                                             }
+                                             handleUsersResponse(response);
+                                             return true;
+                                         });
 }
 
 void UserManagementWidget::onAddUserClicked()
@@ -170,6 +178,7 @@ void UserManagementWidget::handleUsersResponse(const QJsonObject &response)
 {
     if (response["type"].toString() == "DATA_RESPONSE") {
         populateTable(response["data"].toArray());
+        applyFilter();
     } else {
         QMessageBox::critical(this, "Error", "Failed to fetch users");
     }
@@ -177,8 +186,6 @@ void UserManagementWidget::handleUsersResponse(const QJsonObject &response)
 
 void UserManagementWidget::populateTable(const QJsonArray &users)
 {
-    m_tableWidget->setRowCount(0);
-
     for (const QJsonValue &value : users) {
         QJsonObject user = value.toObject();
         int row = m_tableWidget->rowCount();
@@ -27,13 +27,14 @@ private slots:
 
 private:
     void setupUi();
-    void populateTable(const QJsonArray &users);
+    void populateTable(const QJsonArray &users); // Appends to the rows already shown
 
     FilterWidget *m_filterWidget;
     QTableWidget *m_tableWidget;
     QPushButton *m_refreshButton;
     QPushButton *m_addButton;
     QPushButton *m_deleteButton;
+    int m_refreshGeneration = 0;
 };
 
 #endif // USERMANAGEMENTWIDGET_H
@@ -4,9 +4,11 @@
 #include <QLineEdit>
 #include <QListView>
 #include <QMessageBox>
+#include <QPointer>
 #include <QPushButton>
 #include <QRegularExpression>
 #include <QStringListModel>
+#include <QTimer>
 #include <QVBoxLayout>
 
 UserSearchDialog::UserSearchDialog(QWidget *parent)
@@ -36,6 +38,12 @@ void UserSearchDialog::setupUi()
     m_okButton->setEnabled(false);
     layout->addWidget(buttonBox);
 
+    // The server does the matching, so typing only sends a search once it pauses
+    m_searchTimer = new QTimer(this);
+    m_searchTimer->setSingleShot(true);
+    m_searchTimer->setInterval(250);
+
+    connect(m_searchTimer, &QTimer::timeout, this, &UserSearchDialog::fetchUsers);
     connect(m_searchEdit, &QLineEdit::textChanged, this, &UserSearchDialog::filterUsers);
     connect(m_userListView->selectionModel(),
             &QItemSelectionModel::selectionChanged,
@@ -47,34 +55,49 @@ void UserSearchDialog::setupUi()
 
 void UserSearchDialog::fetchUsers()
 {
-    NetworkManager::instance()
-        .sendCommand("GET_ALL_USERS", QJsonObject(), [this](const QJsonObject &response) {
-            if (response["type"].toString() == "DATA_RESPONSE") {
-                m_allUsers = response["data"].toArray();
-                filterUsers(""); // Populate with all users initially
-            } else {
-                QMessageBox::critical(this, "Error", "Failed to fetch user list.");
-            }
-        });
+    // Rows are appended page by page; a newer search abandons the pages of an older one
+    int generation = ++m_searchGeneration;
+    m_userModel->setStringList(QStringList());
+    m_userListView->clearSelection();
+    m_okButton->setEnabled(false);
+    m_selectedUserId = -1;
+
+    QJsonObject data;
+    data["search"] = m_searchEdit->text().trimmed();
+
+    // The dialog lives on its opener's stack and may be gone before the last page arrives
+    QPointer<UserSearchDialog> self(this);
+    auto onPage = [self, generation](const QJsonObject &response, bool) {
+        if (!self || generation != self->m_searchGeneration) {
+            return false;
+        }
+        if (response["type"].toString() != "DATA_RESPONSE") {
+            QMessageBox::critical(self, "Error", "Failed to fetch user list.");
+            return false;
+        }
+        self->appendUsers(response["data"].toArray());
+        return true;
+    };
+    NetworkManager::instance().sendPaged("GET_ALL_USERS", data, onPage);
 }
 
-void UserSearchDialog::filterUsers(const QString &text)
+void UserSearchDialog::filterUsers(const QString &)
 {
-    QStringList userList;
-    for (const QJsonValue &value : m_allUsers) {
+    m_searchTimer->start();
+}
+
+void UserSearchDialog::appendUsers(const QJsonArray &users)
+{
+    int row = m_userModel->rowCount();
+    m_userModel->insertRows(row, users.size());
+    for (const QJsonValue &value : users) {
         QJsonObject user = value.toObject();
-        QString username = user["username"].toString();
-        if (username.contains(text, Qt::CaseInsensitive)) {
-            userList.append(QString("%1 (ID: %2, Role: %3)")
-                                .arg(username)
-                                .arg(user["user_id"].toInt())
-                                .arg(user["role"].toString()));
-        }
+        m_userModel->setData(m_userModel->index(row++),
+                             QString("%1 (ID: %2, Role: %3)")
+                                 .arg(user["username"].toString())
+                                 .arg(user["user_id"].toInt())
+                                 .arg(user["role"].toString()));
     }
-    m_userModel->setStringList(userList);
-    m_userListView->clearSelection();
-    m_okButton->setEnabled(false);
-    m_selectedUserId = -1;
 }
 
 void UserSearchDialog::onUserSelected()
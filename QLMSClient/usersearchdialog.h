@@ -9,6 +9,7 @@ class QLineEdit;
 class QListView;
 class QStringListModel;
 class QPushButton;
+class QTimer;
 QT_END_NAMESPACE
 
 class UserSearchDialog : public QDialog
@@ -22,18 +23,20 @@ public:
 private slots:
     void filterUsers(const QString &text);
     void onUserSelected();
+    void fetchUsers();
 
 private:
     void setupUi();
-    void fetchUsers();
+    void appendUsers(const QJsonArray &users);
 
     QLineEdit *m_searchEdit;
     QListView *m_userListView;
     QPushButton *m_okButton;
+    QTimer *m_searchTimer;
 
-    QJsonArray m_allUsers;
     QStringListModel *m_userModel;
     int m_selectedUserId = -1;
+    int m_searchGeneration = 0;
 };
 
 #endif // USERSEARCHDIALOG_H
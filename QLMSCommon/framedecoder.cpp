@@ -0,0 +1,97 @@
+#include "framedecoder.h"
+#include <QtEndian>
+
+FrameDecoder::FrameDecoder(qsizetype maxFrameSize)
+    : m_maxFrameSize(maxFrameSize)
+{}
+
+void FrameDecoder::append(const QByteArray &data)
+{
+    if (m_frameTooLarge) {
+        return;
+    }
+
+    // Drop consumed frames only once they make up at least half the buffer, so each byte is
+    // moved a bounded number of times however the data is split across reads
+    if (m_readOffset > 0 && m_readOffset >= m_buffer.size() / 2) {
+        m_buffer.remove(0, m_readOffset);
+        m_scanOffset -= m_readOffset;
+        m_readOffset = 0;
+    }
+
+    m_buffer.append(data);
+}
+
+void FrameDecoder::setFraming(Framing framing)
+{
+    m_framing = framing;
+    m_scanOffset = m_readOffset;
+}
+
+bool FrameDecoder::nextFrame(QByteArray &frame, quint8 *flags)
+{
+    if (m_frameTooLarge) {
+        return false;
+    }
+
+    if (m_framing == Framing::LengthPrefixed) {
+        if (m_buffer.size() - m_readOffset < HeaderSize) {
+            return false;
+        }
+
+        const uchar *header = reinterpret_cast<const uchar *>(m_buffer.constData() + m_readOffset);
+        qsizetype length = qFromBigEndian<quint32>(header);
+        if (length > m_maxFrameSize) {
+            m_frameTooLarge = true;
+            return false;
+        }
+        if (m_buffer.size() - m_readOffset - HeaderSize < length) {
+            return false;
+        }
+
+        if (flags) {
+            *flags = header[4];
+        }
+        frame = QByteArray::fromRawData(m_buffer.constData() + m_readOffset + HeaderSize, length);
+        m_readOffset += HeaderSize + length;
+        m_scanOffset = m_readOffset;
+        return true;
+    }
+
+    qsizetype newline = m_buffer.indexOf('\n', m_scanOffset);
+    if (newline < 0) {
+        m_scanOffset = m_buffer.size();
+        if (m_scanOffset - m_readOffset > m_maxFrameSize) {
+            m_frameTooLarge = true;
+        }
+        return false;
+    }
+
+    qsizetype length = newline - m_readOffset;
+    if (length > m_maxFrameSize) {
+        m_frameTooLarge = true;
+        return false;
+    }
+
+    if (flags) {
+        *flags = 0;
+    }
+    frame = QByteArray::fromRawData(m_buffer.constData() + m_readOffset, length);
+    m_readOffset = newline + 1;
+    m_scanOffset = m_readOffset;
+    return true;
+}
+
+void FrameDecoder::writeHeader(char *out, qsizetype payloadSize, quint8 flags)
+{
+    qToBigEndian<quint32>(quint32(payloadSize), out);
+    out[4] = char(flags);
+}
+
+void FrameDecoder::clear()
+{
+    m_buffer.clear();
+    m_readOffset = 0;
+    m_scanOffset = 0;
+    m_frameTooLarge = false;
+}
@@ -0,0 +1,53 @@
+#ifndef FRAMEDECODER_H
+#define FRAMEDECODER_H
+
+#include <QByteArray>
+
+// Incremental decoder for newline-delimited or length-prefixed frames. Remembers how far the
+// buffer has been scanned, hands out frames without copying, and compacts consumed bytes in
+// amortized O(n).
+class FrameDecoder
+{
+public:
+    enum class Framing {
+        Newline,        // Payload followed by '\n'
+        LengthPrefixed, // 32-bit big-endian payload length, one flags byte, then the payload
+    };
+
+    static constexpr qsizetype HeaderSize = 5;
+
+    explicit FrameDecoder(qsizetype maxFrameSize = 16 * 1024 * 1024);
+
+    qsizetype maxFrameSize() const { return m_maxFrameSize; }
+    void setMaxFrameSize(qsizetype maxFrameSize) { m_maxFrameSize = maxFrameSize; }
+
+    // Applies to frames not yet returned, so switch only on a frame boundary
+    Framing framing() const { return m_framing; }
+    void setFraming(Framing framing);
+
+    void append(const QByteArray &data);
+
+    // Stores the next complete frame (without its newline or header) in frame, and its flags
+    // byte in flags for length-prefixed frames. The frame refers to the decoder's buffer and is
+    // only valid until the next append() or clear().
+    bool nextFrame(QByteArray &frame, quint8 *flags = nullptr);
+
+    // Fills the HeaderSize bytes at out for a length-prefixed frame
+    static void writeHeader(char *out, qsizetype payloadSize, quint8 flags);
+
+    // Set once a frame grows past maxFrameSize; no further frames are returned until clear()
+    bool frameTooLarge() const { return m_frameTooLarge; }
+
+    qsizetype bufferedBytes() const { return m_buffer.size() - m_readOffset; }
+    void clear();
+
+private:
+    QByteArray m_buffer;
+    qsizetype m_readOffset = 0; // Start of the first unconsumed frame
+    qsizetype m_scanOffset = 0; // Bytes between m_readOffset and here hold no newline
+    qsizetype m_maxFrameSize;
+    Framing m_framing = Framing::Newline;
+    bool m_frameTooLarge = false;
+};
+
+#endif // FRAMEDECODER_H
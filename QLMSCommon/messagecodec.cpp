@@ -0,0 +1,192 @@
+#include "messagecodec.h"
+#include <QAtomicInteger>
+#include <QCborMap>
+#include <QCborStreamWriter>
+#include <QCborValue>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QtEndian>
+
+namespace {
+
+struct CompressionCounters
+{
+    QAtomicInteger<quint64> compressedFrames = 0;
+    QAtomicInteger<quint64> skippedFrames = 0; // Above the threshold but not smaller compressed
+    QAtomicInteger<quint64> bytesIn = 0;
+    QAtomicInteger<quint64> bytesOut = 0;
+    QAtomicInteger<quint64> compressNs = 0;
+    QAtomicInteger<quint64> decompressedFrames = 0;
+    QAtomicInteger<quint64> decompressNs = 0;
+};
+
+CompressionCounters &counters()
+{
+    static CompressionCounters instance;
+    return instance;
+}
+
+} // namespace
+
+MessageCodec::MessageCodec(qsizetype maxFrameSize)
+    : m_decoder(maxFrameSize)
+{}
+
+void MessageCodec::setFormat(Format format)
+{
+    m_format = format;
+    m_decoder.setFraming(format == Format::Cbor ? FrameDecoder::Framing::LengthPrefixed
+                                                : FrameDecoder::Framing::Newline);
+
+    // Newline framing has no flags byte to mark a compressed payload
+    if (format == Format::Json) {
+        m_compressionThreshold = 0;
+    }
+}
+
+QString MessageCodec::formatName(Format format)
+{
+    return format == Format::Cbor ? "cbor" : "json";
+}
+
+bool MessageCodec::formatFromName(const QString &name, Format *format)
+{
+    if (name == "cbor") {
+        *format = Format::Cbor;
+    } else if (name == "json") {
+        *format = Format::Json;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+QJsonObject MessageCodec::statistics()
+{
+    const CompressionCounters &c = counters();
+    quint64 bytesIn = c.bytesIn.loadRelaxed();
+    quint64 bytesOut = c.bytesOut.loadRelaxed();
+
+    QJsonObject stats;
+    stats["compressed_frames"] = static_cast<double>(c.compressedFrames.loadRelaxed());
+    stats["skipped_frames"] = static_cast<double>(c.skippedFrames.loadRelaxed());
+    stats["bytes_in"] = static_cast<double>(bytesIn);
+    stats["bytes_out"] = static_cast<double>(bytesOut);
+    stats["ratio"] = bytesOut > 0 ? double(bytesIn) / double(bytesOut) : 0.0;
+    stats["compress_ms"] = double(c.compressNs.loadRelaxed()) / 1e6;
+    stats["decompressed_frames"] = static_cast<double>(c.decompressedFrames.loadRelaxed());
+    stats["decompress_ms"] = double(c.decompressNs.loadRelaxed()) / 1e6;
+    return stats;
+}
+
+bool MessageCodec::nextMessage(QJsonObject &message)
+{
+    QByteArray frame;
+    quint8 flags = 0;
+    while (m_decoder.nextFrame(frame, &flags)) {
+        if (decodePayload(frame, flags, message)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool MessageCodec::decodePayload(const QByteArray &frame, quint8 flags, QJsonObject &message)
+{
+    if (m_format == Format::Json) {
+        QJsonDocument doc = QJsonDocument::fromJson(frame);
+        if (doc.isObject()) {
+            message = doc.object();
+            return true;
+        }
+        qWarning() << "Skipping invalid JSON frame:" << frame.left(200);
+        return false;
+    }
+
+    QByteArray payload = frame;
+    if (flags & Compressed) {
+        // qUncompress allocates whatever the size prefix claims, so check it against the limit
+        if (frame.size() < 4
+            || qFromBigEndian<quint32>(frame.constData()) > quint64(m_decoder.maxFrameSize())) {
+            qWarning() << "Skipping compressed frame with an invalid or oversized length";
+            return false;
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        payload = qUncompress(frame);
+        counters().decompressNs.fetchAndAddRelaxed(timer.nsecsElapsed());
+        counters().decompressedFrames.ref();
+        if (payload.isEmpty()) {
+            qWarning() << "Skipping frame that failed to decompress";
+            return false;
+        }
+    }
+
+    QCborParserError error;
+    QCborValue value = QCborValue::fromCbor(payload, &error);
+    if (error.error == QCborError::NoError && value.isMap()) {
+        message = value.toMap().toJsonObject();
+        return true;
+    }
+    qWarning() << "Skipping invalid CBOR frame of" << payload.size() << "bytes";
+    return false;
+}
+
+QByteArray MessageCodec::encode(const QJsonObject &message) const
+{
+    QByteArray frame;
+    encode(message, frame);
+    return frame;
+}
+
+void MessageCodec::encode(const QJsonObject &message, QByteArray &out) const
+{
+    if (m_format == Format::Json) {
+        out += QJsonDocument(message).toJson(QJsonDocument::Compact);
+        out += '\n';
+        return;
+    }
+
+    // Reserve the header and let the writer append the payload behind it, so the frame is
+    // built in place
+    qsizetype headerPos = out.size();
+    out.resize(headerPos + FrameDecoder::HeaderSize);
+    {
+        QCborStreamWriter writer(&out);
+        QCborValue::fromJsonValue(message).toCbor(writer);
+    }
+    qsizetype payloadPos = headerPos + FrameDecoder::HeaderSize;
+    qsizetype payloadSize = out.size() - payloadPos;
+
+    if (m_compressionThreshold > 0 && payloadSize >= m_compressionThreshold) {
+        QElapsedTimer timer;
+        timer.start();
+        QByteArray compressed = qCompress(reinterpret_cast<const uchar *>(out.constData()
+                                                                          + payloadPos),
+                                          payloadSize);
+        counters().compressNs.fetchAndAddRelaxed(timer.nsecsElapsed());
+
+        // Already compact payloads can come out larger; send those as they are
+        if (compressed.size() < payloadSize) {
+            counters().compressedFrames.ref();
+            counters().bytesIn.fetchAndAddRelaxed(payloadSize);
+            counters().bytesOut.fetchAndAddRelaxed(compressed.size());
+
+            out.resize(payloadPos);
+            out.append(compressed);
+            FrameDecoder::writeHeader(out.data() + headerPos, compressed.size(), Compressed);
+            return;
+        }
+        counters().skippedFrames.ref();
+    }
+
+    FrameDecoder::writeHeader(out.data() + headerPos, payloadSize, 0);
+}
+
+void MessageCodec::clear()
+{
+    m_decoder.clear();
+    setFormat(Format::Json);
+}
@@ -0,0 +1,60 @@
+#ifndef MESSAGECODEC_H
+#define MESSAGECODEC_H
+
+#include "framedecoder.h"
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+
+// Turns protocol messages into frames and back. Connections start out as newline-delimited
+// JSON; a HELLO exchange may switch both directions to length-prefixed CBOR and enable zlib
+// compression of large frames.
+class MessageCodec
+{
+public:
+    enum class Format { Json, Cbor };
+
+    enum FrameFlag : quint8 {
+        Compressed = 0x01, // Payload is qCompress() output: 32-bit expected size, then zlib
+    };
+
+    explicit MessageCodec(qsizetype maxFrameSize = 16 * 1024 * 1024);
+
+    Format format() const { return m_format; }
+    void setFormat(Format format);
+
+    static QString formatName(Format format);
+    static bool formatFromName(const QString &name, Format *format);
+
+    // Outgoing CBOR payloads of at least this many bytes are compressed; 0 disables compression.
+    // Compressed frames are always accepted, since they can only arrive after negotiation.
+    qsizetype compressionThreshold() const { return m_compressionThreshold; }
+    void setCompressionThreshold(qsizetype bytes) { m_compressionThreshold = bytes; }
+
+    // Process-wide compression counters of all codecs
+    static QJsonObject statistics();
+
+    void append(const QByteArray &data) { m_decoder.append(data); }
+
+    // Decodes the next complete message; frames that don't hold an object are logged and skipped
+    bool nextMessage(QJsonObject &message);
+
+    QByteArray encode(const QJsonObject &message) const;
+    // Appends the frame to out, so several messages can share one buffer and one write
+    void encode(const QJsonObject &message, QByteArray &out) const;
+
+    qsizetype maxFrameSize() const { return m_decoder.maxFrameSize(); }
+    bool frameTooLarge() const { return m_decoder.frameTooLarge(); }
+    // Received bytes not yet returned as messages
+    qsizetype bufferedBytes() const { return m_decoder.bufferedBytes(); }
+    void clear();
+
+private:
+    bool decodePayload(const QByteArray &frame, quint8 flags, QJsonObject &message);
+
+    FrameDecoder m_decoder;
+    Format m_format = Format::Json;
+    qsizetype m_compressionThreshold = 0;
+};
+
+#endif // MESSAGECODEC_H
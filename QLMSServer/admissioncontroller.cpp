@@ -0,0 +1,72 @@
+#include "admissioncontroller.h"
+
+AdmissionController &AdmissionController::instance()
+{
+    static AdmissionController instance;
+    return instance;
+}
+
+AdmissionController::AdmissionController() {}
+
+void AdmissionController::configure(int capacity)
+{
+    QMutexLocker locker(&m_mutex);
+    m_capacity = qMax(2, capacity);
+}
+
+bool AdmissionController::tryAdmit(CommandPriority priority, int *retryAfterMs)
+{
+    QMutexLocker locker(&m_mutex);
+    int index = static_cast<int>(priority);
+
+    int threshold = m_capacity;
+    if (priority == CommandPriority::Bulk) {
+        threshold = m_capacity / 2;
+    }
+
+    if (priority != CommandPriority::Critical && m_load >= threshold) {
+        ++m_shed[index];
+        // Roughly how long the commands ahead take to bring the load back under the threshold
+        double estimate = m_averageMs * m_load / threshold;
+        *retryAfterMs = qBound(MinRetryAfterMs, qRound(estimate), MaxRetryAfterMs);
+        return false;
+    }
+
+    ++m_admitted[index];
+    ++m_load;
+    m_peakLoad = qMax(m_peakLoad, m_load);
+    return true;
+}
+
+void AdmissionController::release(qint64 elapsedMs)
+{
+    QMutexLocker locker(&m_mutex);
+    --m_load;
+    m_averageMs = m_averageMs == 0 ? elapsedMs : m_averageMs * 0.9 + elapsedMs * 0.1;
+}
+
+void AdmissionController::recordRateLimited(CommandPriority priority)
+{
+    QMutexLocker locker(&m_mutex);
+    ++m_rateLimited[static_cast<int>(priority)];
+}
+
+QJsonObject AdmissionController::statistics() const
+{
+    static const char *names[PriorityCount] = {"critical", "interactive", "bulk"};
+
+    QMutexLocker locker(&m_mutex);
+    QJsonObject stats;
+    stats["capacity"] = m_capacity;
+    stats["load"] = m_load;
+    stats["peak_load"] = m_peakLoad;
+    stats["avg_command_ms"] = m_averageMs;
+    for (int i = 0; i < PriorityCount; ++i) {
+        QJsonObject counts;
+        counts["admitted"] = static_cast<double>(m_admitted[i]);
+        counts["shed"] = static_cast<double>(m_shed[i]);
+        counts["rate_limited"] = static_cast<double>(m_rateLimited[i]);
+        stats[names[i]] = counts;
+    }
+    return stats;
+}
@@ -0,0 +1,47 @@
+#ifndef ADMISSIONCONTROLLER_H
+#define ADMISSIONCONTROLLER_H
+
+#include "commandscheduler.h"
+#include <QJsonObject>
+#include <QMutex>
+
+// Server-wide limit on the commands running or waiting for the database executor. Bulk commands
+// are only admitted while the load is below half the capacity and interactive ones while it is
+// below the capacity, so reports are turned away well before anyone's clicks are.
+class AdmissionController
+{
+public:
+    static AdmissionController &instance();
+
+    void configure(int capacity);
+
+    // Every admitted command must be released once it has finished. A rejected one gets
+    // retryAfterMs, an estimate of when the load will have dropped.
+    bool tryAdmit(CommandPriority priority, int *retryAfterMs);
+    void release(qint64 elapsedMs);
+
+    // Counts a command a client sent faster than its rate limit allows
+    void recordRateLimited(CommandPriority priority);
+
+    QJsonObject statistics() const;
+
+private:
+    AdmissionController();
+    AdmissionController(const AdmissionController &) = delete;
+    AdmissionController &operator=(const AdmissionController &) = delete;
+
+    static constexpr int PriorityCount = 3;
+    static constexpr int MinRetryAfterMs = 100;
+    static constexpr int MaxRetryAfterMs = 5000;
+
+    mutable QMutex m_mutex;
+    int m_capacity = 64;
+    int m_load = 0;
+    int m_peakLoad = 0;
+    double m_averageMs = 0; // Moving average of how long admitted commands take
+    quint64 m_admitted[PriorityCount] = {};
+    quint64 m_shed[PriorityCount] = {};
+    quint64 m_rateLimited[PriorityCount] = {};
+};
+
+#endif // ADMISSIONCONTROLLER_H
@@ -1,50 +1,130 @@
 #include "clienthandler.h"
 #include "coursematerial.h"
 #include "databasemanager.h"
+#include "notificationhub.h"
+#include "sessiontokens.h"
 #include "user.h"
 #include <QCryptographicHash>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QJsonArray>
-#include <QJsonDocument>
 #include <QSslCertificate>
 #include <QSslKey>
 #include <QSslSocket>
 #include <QThread>
 
-ClientHandler::ClientHandler(QSslSocket *socket, QObject *parent)
+ClientHandler::ClientHandler(QSslSocket *socket, const ServerOptions &options, QObject *parent)
     : QObject(parent)
     , m_socket(socket)
-{}
+    , m_codec(options.maxMessageSize)
+    , m_compressionThreshold(options.compressionThreshold)
+    , m_maxQueuedCommands(qMax(1, options.maxQueuedCommands))
+    , m_maxQueuedBytes(qMax<qsizetype>(1, options.maxQueuedBytes))
+    , m_maxPipelined(qMax(1, options.maxPipelinedCommands))
+    , m_outputHighWater(qMax<qsizetype>(1, options.outputHighWater))
+    , m_outputLowWater(qBound<qsizetype>(0, options.outputLowWater, m_outputHighWater))
+{
+    // Bursts of twice the rate let a screen load its lists at once; critical commands are free
+    m_rateLimits[static_cast<int>(CommandPriority::Interactive)]
+        = TokenBucket(options.interactiveRate, 2 * options.interactiveRate);
+    m_rateLimits[static_cast<int>(CommandPriority::Bulk)] = TokenBucket(options.bulkRate,
+                                                                        2 * options.bulkRate);
+    m_clock.start();
+}
 
-ClientHandler::~ClientHandler() {}
+ClientHandler::~ClientHandler()
+{
+    NotificationHub::instance().unsubscribeAll(this);
+}
 
 void ClientHandler::startProcessing()
 {
-    // Now that we are in the correct thread, connect the socket's signals.
+    // Now that we are in the correct thread, take ownership of the socket and connect its signals.
+    m_socket->setParent(this);
     connect(m_socket, &QSslSocket::readyRead, this, &ClientHandler::onReadyRead);
+    connect(m_socket, &QSslSocket::encryptedBytesWritten, this, &ClientHandler::onBytesWritten);
     connect(m_socket, &QSslSocket::disconnected, this, &ClientHandler::onDisconnected);
     connect(m_socket, &QSslSocket::sslErrors, this, &ClientHandler::onSslErrors);
 
     emit logMessage(QString("Client connected from %1").arg(m_socket->peerAddress().toString()));
+
+    // The peer may have gone away while the handler was queued on its event loop
+    if (m_socket->state() == QAbstractSocket::UnconnectedState) {
+        onDisconnected();
+    }
 }
 
 void ClientHandler::onReadyRead()
 {
-    if (!m_socket)
+    // After a protocol error the connection is only kept open to flush the error response.
+    // While reads are paused, new requests stay in the socket until the output drains.
+    if (!m_socket || m_codec.frameTooLarge() || m_readsPaused)
         return;
 
-    m_buffer.append(m_socket->readAll());
+    // Over the input limits only requests already received are decoded; see updateInputPause()
+    if (!m_inputPaused) {
+        m_codec.append(m_socket->readAll());
+    }
 
-    int pos;
-    while ((pos = m_buffer.indexOf('\n')) != -1) {
-        QByteArray messageData = m_buffer.left(pos);
-        m_buffer.remove(0, pos + 1);
+    QJsonObject message;
+    while (m_pendingMessages.size() < m_maxQueuedCommands && m_codec.nextMessage(message)) {
+        m_pendingMessages.enqueue(message);
+    }
 
-        QJsonDocument doc = QJsonDocument::fromJson(messageData);
-        if (!doc.isNull() && doc.isObject()) {
-            processMessage(doc.object());
-        }
+    if (m_codec.frameTooLarge()) {
+        emit logMessage(QString("Closing connection from %1: message exceeds %2 bytes")
+                            .arg(m_socket->peerAddress().toString())
+                            .arg(m_codec.maxFrameSize()));
+
+        QJsonObject response;
+        response["type"] = "ERROR";
+        response["message"] = QString("Message exceeds the maximum size of %1 bytes")
+                                  .arg(m_codec.maxFrameSize());
+        sendResponse(response);
+        flushOutput();
+
+        m_pendingMessages.clear();
+        m_socket->disconnectFromHost();
+        return;
+    }
+
+    processNextMessage();
+    updateInputPause();
+}
+
+// A client that sends requests faster than they run must not make the server queue them without
+// limit. Past the limits its requests stay in the socket, whose small read buffer fills up and
+// lets TCP flow control slow the client down.
+void ClientHandler::updateInputPause()
+{
+    bool backlogged = m_pendingMessages.size() >= m_maxQueuedCommands
+                      || (!m_pendingMessages.isEmpty()
+                          && m_codec.bufferedBytes() >= m_maxQueuedBytes);
+    if (backlogged == m_inputPaused || m_disconnected)
+        return;
+
+    m_inputPaused = backlogged;
+    m_socket->setReadBufferSize(m_inputPaused || m_readsPaused ? PausedReadBufferSize : 0);
+    if (m_inputPaused) {
+        emit logMessage(QString("Pausing reads from %1: %2 requests waiting")
+                            .arg(m_socket->peerAddress().toString())
+                            .arg(m_pendingMessages.size()));
+    } else {
+        // Picks up what the socket buffered meanwhile; readyRead isn't emitted for it again
+        QMetaObject::invokeMethod(this, &ClientHandler::onReadyRead, Qt::QueuedConnection);
+    }
+}
+
+void ClientHandler::onBytesWritten()
+{
+    if (m_readsPaused && pendingOutput() <= m_outputLowWater) {
+        m_readsPaused = false;
+        m_socket->setReadBufferSize(m_inputPaused ? PausedReadBufferSize : 0);
+        emit logMessage(QString("Resuming reads from %1").arg(m_socket->peerAddress().toString()));
+
+        // Picks up the requests that arrived meanwhile and restarts the queue
+        onReadyRead();
     }
 }
 
@@ -54,9 +134,14 @@ void ClientHandler::onDisconnected()
                         .arg(m_socket ? m_socket->peerAddress().toString() : "unknown"));
     emit clientDisconnected(this);
 
-    // The worker's job is done, so we tell its thread to quit the event loop.
-    if (thread()) {
-        thread()->quit();
+    m_disconnected = true;
+    m_pendingMessages.clear();
+    NotificationHub::instance().unsubscribeAll(this);
+
+    // The event loop is shared with other clients, so only this worker (and its socket) goes away.
+    // A command still running on the database executor finishes first; see startCommand().
+    if (m_commandsInFlight == 0) {
+        deleteLater();
     }
 }
 
@@ -68,80 +153,289 @@ void ClientHandler::onSslErrors(const QList<QSslError> &errors)
     m_socket->ignoreSslErrors();
 }
 
-void ClientHandler::processMessage(const QJsonObject &message)
+void ClientHandler::processNextMessage()
+{
+    while (!m_disconnected && !m_readsPaused && !m_pendingMessages.isEmpty()
+           && canStart(m_pendingMessages.head())) {
+        QJsonObject message = m_pendingMessages.dequeue();
+
+        // Rejected in turn, so an untagged command's BUSY still arrives in order
+        QJsonObject rejection = checkAdmission(findCommand(message["command"].toString()),
+                                               message["data"].toObject());
+        if (rejection.isEmpty()) {
+            startCommand(message);
+            continue;
+        }
+        if (message.contains("request_id")) {
+            rejection["request_id"] = message["request_id"];
+        }
+        sendResponse(rejection);
+    }
+}
+
+// Messages tagged with a request_id may run concurrently and be answered out of order, up to
+// m_maxPipelined at a time. Untagged and exclusive commands run alone, in arrival order.
+bool ClientHandler::canStart(const QJsonObject &message) const
+{
+    if (m_commandsInFlight == 0)
+        return true;
+    if (m_serialInFlight || m_commandsInFlight >= m_maxPipelined)
+        return false;
+
+    const CommandSpec *spec = findCommand(message["command"].toString());
+    return message.contains("request_id") && !(spec && spec->exclusive);
+}
+
+void ClientHandler::startCommand(const QJsonObject &message)
 {
     QString command = message["command"].toString();
     QJsonObject data = message["data"].toObject();
+    QJsonValue requestId = message.value("request_id");
+    const CommandSpec *spec = findCommand(command);
+    bool serial = requestId.isUndefined() || (spec && spec->exclusive);
 
     emit logMessage(QString("Received command: %1").arg(command));
 
-    if (command == "LOGIN") {
-        handleLogin(data);
-    } else if (command == "LOGOUT") {
-        handleLogout();
-    } else if (!m_currentUser) {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Not authenticated";
-        sendResponse(response);
-    } else if (command == "GET_ALL_USERS") {
-        handleGetAllUsers();
-    } else if (command == "CREATE_USER") {
-        handleCreateUser(data);
-    } else if (command == "DELETE_USER") {
-        handleDeleteUser(data);
-    } else if (command == "GET_ALL_CLASSES") {
-        handleGetAllClasses();
-    } else if (command == "CREATE_CLASS") {
-        handleCreateClass(data);
-    } else if (command == "DELETE_CLASS") {
-        handleDeleteClass(data);
-    } else if (command == "ASSIGN_USER_TO_CLASS") {
-        handleAssignUserToClass(data);
-    } else if (command == "REMOVE_USER_FROM_CLASS") {
-        handleRemoveUserFromClass(data);
-    } else if (command == "GET_CLASS_MEMBERS") {
-        handleGetClassMembers(data);
-    } else if (command == "GET_COURSES_FOR_CLASS") {
-        handleGetCoursesForClass(data);
-    } else if (command == "CREATE_COURSE") {
-        handleCreateCourse(data);
-    } else if (command == "DELETE_COURSE") {
-        handleDeleteCourse(data);
-    } else if (command == "GET_MATERIALS_FOR_COURSE") {
-        handleGetMaterialsForCourse(data);
-    } else if (command == "CREATE_LESSON") {
-        handleCreateLesson(data);
-    } else if (command == "CREATE_QUIZ_WITH_QUESTIONS") {
-        handleCreateQuizWithQuestions(data);
-    } else if (command == "DELETE_MATERIAL") {
-        handleDeleteMaterial(data);
-    } else if (command == "GET_MATERIAL_DETAILS") {
-        handleGetMaterialDetails(data);
-    } else if (command == "START_QUIZ") {
-        handleStartQuiz(data);
-    } else if (command == "FINISH_ATTEMPT") {
-        handleFinishAttempt(data);
-    } else if (command == "GET_MY_ATTEMPTS") {
-        handleGetMyAttempts();
-    } else if (command == "GET_ATTEMPT_DETAILS") {
-        handleGetAttemptDetails(data);
-    } else if (command == "GET_PENDING_ATTEMPTS") {
-        handleGetPendingAttempts();
-    } else if (command == "GET_STUDENT_ATTEMPTS_FOR_QUIZ") {
-        handleGetStudentAttemptsForQuiz(data);
-    } else if (command == "GET_CLASS_STATISTICS") {
-        handleGetClassStatistics(data);
-    } else if (command == "GET_COURSE_STATISTICS") {
-        handleGetCourseStatistics(data);
-    } else if (command == "SUBMIT_GRADE") {
-        handleSubmitGrade(data);
+    QElapsedTimer admitted;
+    admitted.start();
+
+    // Unknown commands fail without a query, so they needn't wait behind anything
+    CommandPriority priority = spec ? spec->priority : CommandPriority::Critical;
+
+    ++m_commandsInFlight;
+    m_serialInFlight = serial;
+    DatabaseManager::instance()
+        .runAsync(priority, [this, command, spec, data]() {
+            QElapsedTimer timer;
+            timer.start();
+            QJsonObject response = dispatch(spec, data);
+            if (spec && timer.elapsed() > spec->timeoutMs) {
+                qWarning() << "Command" << command << "took" << timer.elapsed()
+                           << "ms, budget is" << spec->timeoutMs << "ms";
+            }
+            return response;
+        })
+        .then(this, [this, spec, admitted, requestId, serial](QJsonObject response) {
+            if (spec) {
+                AdmissionController::instance().release(admitted.elapsed());
+            }
+            --m_commandsInFlight;
+            if (serial) {
+                m_serialInFlight = false;
+            }
+            if (m_disconnected) {
+                if (m_commandsInFlight == 0) {
+                    deleteLater();
+                }
+                return;
+            }
+
+            if (!requestId.isUndefined()) {
+                response["request_id"] = requestId;
+            }
+            sendResponse(response);
+
+            // The HELLO reply still goes out in the old format; the client switches on reading it
+            if (m_codec.format() != m_negotiatedFormat) {
+                m_codec.setFormat(m_negotiatedFormat);
+                if (m_negotiatedCompression) {
+                    m_codec.setCompressionThreshold(m_compressionThreshold);
+                }
+            }
+            // Also decodes the requests held back while the queue was full
+            onReadyRead();
+        });
+}
+
+QJsonObject ClientHandler::checkAdmission(const CommandSpec *spec, const QJsonObject &data)
+{
+    // Unknown commands are answered without touching the database
+    if (!spec)
+        return QJsonObject();
+
+    // A batch pays for each of its commands in that command's class, so wrapping commands in
+    // BATCH doesn't get around the rate limits. Commands a batch refuses to run are free; an
+    // oversized batch is refused here, before it is charged for anything.
+    int cost[PriorityCount] = {};
+    if (spec->handler == &ClientHandler::handleBatch) {
+        const QJsonArray commands = data["commands"].toArray();
+        if (commands.size() > MaxBatchSize) {
+            return errorResponse(
+                QString("A batch may hold at most %1 commands").arg(MaxBatchSize));
+        }
+        for (const QJsonValue &value : commands) {
+            const CommandSpec *entry = findCommand(value["command"].toString());
+            if (entry && allowedInBatch(entry)) {
+                ++cost[static_cast<int>(entry->priority)];
+            }
+        }
     } else {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unknown command";
-        sendResponse(response);
+        ++cost[static_cast<int>(spec->priority)];
+    }
+
+    // All or nothing, so a rejected batch leaves the buckets as they were
+    AdmissionController &admission = AdmissionController::instance();
+    qint64 now = m_clock.elapsed();
+    int retryAfterMs = 0;
+    for (int i = 0; i < PriorityCount; ++i) {
+        retryAfterMs = qMax(retryAfterMs, m_rateLimits[i].waitFor(now, cost[i]));
+    }
+    if (retryAfterMs > 0) {
+        admission.recordRateLimited(spec->priority);
+        return busyResponse(retryAfterMs, "Too many requests");
+    }
+
+    // One slot for a batch too: its commands run one after another on a single executor thread
+    if (!admission.tryAdmit(spec->priority, &retryAfterMs)) {
+        return busyResponse(retryAfterMs, "The server is busy");
+    }
+    for (int i = 0; i < PriorityCount; ++i) {
+        m_rateLimits[i].take(cost[i]);
+    }
+    return QJsonObject();
+}
+
+// Runs on the database executor, possibly for several commands of this client at once.
+// m_currentUser is only replaced by exclusive commands, which never overlap with others.
+QJsonObject ClientHandler::dispatch(const CommandSpec *spec, const QJsonObject &data)
+{
+    if (!spec) {
+        return errorResponse("Unknown command");
+    }
+    if (spec->requiresAuth) {
+        if (!m_currentUser) {
+            return errorResponse("Not authenticated");
+        }
+        if (!spec->roles.testFlag(m_currentUser->getUserRole())) {
+            return errorResponse("Unauthorized");
+        }
+    }
+
+    return (this->*spec->handler)(data);
+}
+
+const QHash<QString, ClientHandler::CommandSpec> &ClientHandler::commandTable()
+{
+    using Priority = CommandPriority;
+    const UserRoles admin = UserRole::Admin;
+    const UserRoles instructor = UserRole::Instructor;
+    const UserRoles student = UserRole::Student;
+    const UserRoles anyRole = admin | instructor | student;
+
+    // Built once; lookups hand out pointers into it, so it must never change afterwards
+    static const QHash<QString, CommandSpec> table = {
+        // Session
+        {"HELLO", {&ClientHandler::handleHello, false, {}, 5000, Priority::Critical, true}},
+        {"LOGIN", {&ClientHandler::handleLogin, false, {}, 5000, Priority::Critical, true}},
+        {"LOGOUT", {&ClientHandler::handleLogout, false, {}, 5000, Priority::Critical, true}},
+        {"RESUME_SESSION",
+         {&ClientHandler::handleResumeSession, false, {}, 5000, Priority::Critical, true}},
+        {"BATCH", {&ClientHandler::handleBatch, true, anyRole, 30000, Priority::Bulk}},
+        {"SUBSCRIBE", {&ClientHandler::handleSubscribe, true, anyRole}},
+        {"UNSUBSCRIBE", {&ClientHandler::handleUnsubscribe, true, anyRole}},
+
+        // Administration
+        {"GET_ALL_USERS", {&ClientHandler::handleGetAllUsers, true, admin, 10000, Priority::Bulk}},
+        {"CREATE_USER", {&ClientHandler::handleCreateUser, true, admin}},
+        {"DELETE_USER", {&ClientHandler::handleDeleteUser, true, admin}},
+        {"GET_ALL_CLASSES", {&ClientHandler::handleGetAllClasses, true, anyRole}},
+        {"CREATE_CLASS", {&ClientHandler::handleCreateClass, true, admin}},
+        {"DELETE_CLASS", {&ClientHandler::handleDeleteClass, true, admin}},
+        {"ASSIGN_USER_TO_CLASS", {&ClientHandler::handleAssignUserToClass, true, admin}},
+        {"REMOVE_USER_FROM_CLASS", {&ClientHandler::handleRemoveUserFromClass, true, admin}},
+        {"GET_CLASS_MEMBERS", {&ClientHandler::handleGetClassMembers, true, admin}},
+        {"GET_CLASS_TREE", {&ClientHandler::handleGetClassTree, true, anyRole, 10000}},
+        {"GET_COURSES_FOR_CLASS", {&ClientHandler::handleGetCoursesForClass, true, anyRole}},
+        {"CREATE_COURSE", {&ClientHandler::handleCreateCourse, true, admin}},
+        {"DELETE_COURSE", {&ClientHandler::handleDeleteCourse, true, admin}},
+
+        // Course materials
+        {"GET_MATERIALS_FOR_COURSE", {&ClientHandler::handleGetMaterialsForCourse, true, anyRole}},
+        {"GET_MATERIAL_DETAILS", {&ClientHandler::handleGetMaterialDetails, true, anyRole}},
+        {"GET_LESSON_CHUNK", {&ClientHandler::handleGetLessonChunk, true, anyRole}},
+        {"CREATE_LESSON", {&ClientHandler::handleCreateLesson, true, instructor}},
+        {"CREATE_QUIZ_WITH_QUESTIONS",
+         {&ClientHandler::handleCreateQuizWithQuestions, true, instructor, 10000}},
+        {"DELETE_MATERIAL", {&ClientHandler::handleDeleteMaterial, true, instructor}},
+
+        // Quiz attempts
+        {"START_QUIZ", {&ClientHandler::handleStartQuiz, true, student}},
+        {"FINISH_ATTEMPT",
+         {&ClientHandler::handleFinishAttempt, true, student, 10000, Priority::Critical}},
+        {"GET_MY_ATTEMPTS", {&ClientHandler::handleGetMyAttempts, true, student}},
+        {"GET_ATTEMPT_DETAILS", {&ClientHandler::handleGetAttemptDetails, true, anyRole}},
+
+        // Grading and reports
+        {"GET_PENDING_ATTEMPTS", {&ClientHandler::handleGetPendingAttempts, true, instructor}},
+        {"GET_STUDENT_ATTEMPTS_FOR_QUIZ",
+         {&ClientHandler::handleGetStudentAttemptsForQuiz, true, instructor}},
+        {"SUBMIT_GRADE", {&ClientHandler::handleSubmitGrade, true, instructor}},
+        {"GET_CLASS_STATISTICS",
+         {&ClientHandler::handleGetClassStatistics, true, instructor, 15000, Priority::Bulk}},
+        {"GET_COURSE_STATISTICS",
+         {&ClientHandler::handleGetCourseStatistics, true, instructor, 15000, Priority::Bulk}},
+    };
+    return table;
+}
+
+const ClientHandler::CommandSpec *ClientHandler::findCommand(const QString &command)
+{
+    const QHash<QString, CommandSpec> &table = commandTable();
+    auto it = table.constFind(command);
+    return it != table.constEnd() ? &it.value() : nullptr;
+}
+
+// Session changes and nested batches only make sense as top-level commands. Critical commands
+// such as FINISH_ATTEMPT are sent on their own, since a batch is scheduled and admitted as bulk
+// work and would make them wait behind reports.
+bool ClientHandler::allowedInBatch(const CommandSpec *spec)
+{
+    return !spec->exclusive && spec->handler != &ClientHandler::handleBatch
+           && spec->priority != CommandPriority::Critical;
+}
+
+QJsonObject ClientHandler::errorResponse(const QString &message)
+{
+    QJsonObject response;
+    response["type"] = "ERROR";
+    response["message"] = message;
+    return response;
+}
+
+QJsonObject ClientHandler::pageResponse(const QJsonArray &rows, const QString &nextCursor)
+{
+    QJsonObject response;
+    response["type"] = "DATA_RESPONSE";
+    response["data"] = rows;
+    if (!nextCursor.isEmpty()) {
+        response["next_cursor"] = nextCursor;
     }
+    return response;
+}
+
+QJsonObject ClientHandler::notModifiedResponse(qint64 version)
+{
+    QJsonObject response;
+    response["type"] = "NOT_MODIFIED";
+    response["version"] = version;
+    return response;
+}
+
+QJsonObject ClientHandler::busyResponse(int retryAfterMs, const QString &message)
+{
+    QJsonObject response;
+    response["type"] = "BUSY";
+    response["message"] = message;
+    response["retry_after_ms"] = retryAfterMs;
+    return response;
+}
+
+bool ClientHandler::isUnchanged(const QJsonObject &data, const QString &key, qint64 *version)
+{
+    // Read before the data is fetched, so a concurrent write leaves the response looking stale
+    VersionRegistry &versions = DatabaseManager::instance().versions();
+    *version = versions.version(key);
+    return data.contains("if_version") && versions.matches(key, data["if_version"].toInteger());
 }
 
 void ClientHandler::sendResponse(const QJsonObject &response)
@@ -149,13 +443,66 @@ void ClientHandler::sendResponse(const QJsonObject &response)
     if (!m_socket || m_socket->state() != QAbstractSocket::ConnectedState)
         return;
 
-    QJsonDocument doc(response);
-    QByteArray data = doc.toJson(QJsonDocument::Compact) + "\n";
-    m_socket->write(data);
-    m_socket->flush();
+    m_codec.encode(response, m_outputBuffer);
+
+    // Responses completed in the same event loop iteration leave in one write and TLS record
+    if (!m_flushScheduled) {
+        m_flushScheduled = true;
+        QMetaObject::invokeMethod(this, &ClientHandler::flushOutput, Qt::QueuedConnection);
+    }
+
+    // A client that doesn't read its responses must not make the server buffer without limit
+    if (!m_readsPaused && pendingOutput() > m_outputHighWater) {
+        m_readsPaused = true;
+        m_socket->setReadBufferSize(PausedReadBufferSize);
+        emit logMessage(QString("Pausing reads from %1: %2 bytes of output pending")
+                            .arg(m_socket->peerAddress().toString())
+                            .arg(pendingOutput()));
+    }
 }
 
-void ClientHandler::handleLogin(const QJsonObject &data)
+void ClientHandler::flushOutput()
+{
+    m_flushScheduled = false;
+    if (m_outputBuffer.isEmpty())
+        return;
+
+    if (m_socket && m_socket->state() == QAbstractSocket::ConnectedState) {
+        m_socket->write(m_outputBuffer);
+        m_socket->flush();
+    }
+    m_outputBuffer.clear();
+}
+
+qsizetype ClientHandler::pendingOutput() const
+{
+    return m_outputBuffer.size() + m_socket->bytesToWrite() + m_socket->encryptedBytesToWrite();
+}
+
+QJsonObject ClientHandler::handleHello(const QJsonObject &data)
+{
+    // Pick the first format the client offers that we support; the client lists its preference
+    MessageCodec::Format format = MessageCodec::Format::Json;
+    const QJsonArray formats = data["formats"].toArray();
+    for (const QJsonValue &name : formats) {
+        if (MessageCodec::formatFromName(name.toString(), &format)) {
+            break;
+        }
+    }
+    m_negotiatedFormat = format;
+
+    // Compressed frames need the flags byte of the binary framing
+    m_negotiatedCompression = format == MessageCodec::Format::Cbor && m_compressionThreshold > 0
+                              && data["compression"].toArray().contains("zlib");
+
+    QJsonObject response;
+    response["type"] = "OK";
+    response["format"] = MessageCodec::formatName(format);
+    response["compression"] = m_negotiatedCompression ? "zlib" : "none";
+    return response;
+}
+
+QJsonObject ClientHandler::handleLogin(const QJsonObject &data)
 {
     QString username = data["username"].toString();
     QString password = data["password"].toString();
@@ -164,12 +511,17 @@ void ClientHandler::handleLogin(const QJsonObject &data)
     QByteArray hash = QCryptographicHash::hash(password.toUtf8(), QCryptographicHash::Sha256);
     QString passwordHash = QString(hash.toHex());
 
+    // Subscriptions belong to the previous user
+    NotificationHub::instance().unsubscribeAll(this);
     m_currentUser = DatabaseManager::instance().authenticateUser(username, passwordHash);
 
     QJsonObject response;
     if (m_currentUser) {
         response["type"] = "LOGIN_SUCCESS";
         response["user"] = m_currentUser->toJson();
+        if (SessionTokens::instance().isEnabled()) {
+            response["session_token"] = SessionTokens::instance().issue(*m_currentUser);
+        }
         emit logMessage(QString("User %1 logged in successfully").arg(username));
     } else {
         response["type"] = "LOGIN_FAIL";
@@ -177,54 +529,185 @@ void ClientHandler::handleLogin(const QJsonObject &data)
         emit logMessage(QString("Failed login attempt for user %1").arg(username));
     }
 
-    sendResponse(response);
+    return response;
+}
+
+QJsonObject ClientHandler::handleResumeSession(const QJsonObject &data)
+{
+    NotificationHub::instance().unsubscribeAll(this);
+    qint64 loggedInAt = 0;
+    m_currentUser = SessionTokens::instance().verify(data["session_token"].toString(),
+                                                     &loggedInAt);
+
+    // Revocations don't survive a restart, so the account must still exist; its role is read
+    // afresh in case it changed. One lookup by primary key, far cheaper than LOGIN.
+    if (m_currentUser) {
+        m_currentUser = DatabaseManager::instance().getUserById(m_currentUser->getId());
+    }
+
+    QJsonObject response;
+    if (m_currentUser) {
+        response["type"] = "LOGIN_SUCCESS";
+        response["user"] = m_currentUser->toJson();
+        // The renewed token expires when the original one would have
+        response["session_token"] = SessionTokens::instance().issue(*m_currentUser, loggedInAt);
+        emit logMessage(
+            QString("User %1 resumed their session").arg(m_currentUser->getUsername()));
+    } else {
+        response["type"] = "LOGIN_FAIL";
+        response["message"] = "Session expired, please log in again";
+    }
+    return response;
 }
 
-void ClientHandler::handleLogout()
+QJsonObject ClientHandler::handleLogout(const QJsonObject &)
 {
     if (m_currentUser) {
         emit logMessage(QString("User %1 logged out").arg(m_currentUser->getUsername()));
         m_currentUser.reset();
     }
+    NotificationHub::instance().unsubscribeAll(this);
 
     QJsonObject response;
     response["type"] = "OK";
     response["message"] = "Logged out successfully";
-    sendResponse(response);
+    return response;
 }
 
-void ClientHandler::handleGetAllUsers()
+QJsonObject ClientHandler::handleBatch(const QJsonObject &data)
 {
-    if (!m_currentUser || m_currentUser->getRole() != "admin") {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
-        return;
+    const QJsonArray commands = data["commands"].toArray();
+    if (commands.size() > MaxBatchSize) {
+        return errorResponse(QString("A batch may hold at most %1 commands").arg(MaxBatchSize));
     }
 
-    auto users = DatabaseManager::instance().getAllUsers();
-    QJsonArray usersArray;
-    for (const auto &user : users) {
-        usersArray.append(user->toJson());
+    // Sub-commands run in order on this executor thread and share one pooled connection
+    ConnectionScope scope = DatabaseManager::instance().connectionScope();
+
+    QJsonArray results;
+    for (const QJsonValue &value : commands) {
+        QJsonObject entry = value.toObject();
+        const CommandSpec *spec = findCommand(entry["command"].toString());
+
+        if (spec && !allowedInBatch(spec)) {
+            results.append(errorResponse("Command not allowed in a batch"));
+            continue;
+        }
+        results.append(dispatch(spec, entry["data"].toObject()));
     }
 
     QJsonObject response;
     response["type"] = "DATA_RESPONSE";
-    response["data"] = usersArray;
-    sendResponse(response);
+    response["data"] = results;
+    return response;
 }
 
-void ClientHandler::handleCreateUser(const QJsonObject &data)
+// Maps a topic name from the client to the hub's topic, or returns an empty string if there is
+// no such topic for the user. Personal topics are keyed by the user's id.
+QString ClientHandler::subscriptionTopic(const QString &name) const
 {
-    if (!m_currentUser || m_currentUser->getRole() != "admin") {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
+    UserRole role = m_currentUser->getUserRole();
+    if (name == "pending_attempts" && role == UserRole::Instructor) {
+        return QString("pending_attempts:%1").arg(m_currentUser->getId());
+    }
+    if (name == "grades" && role == UserRole::Student) {
+        return QString("grades:%1").arg(m_currentUser->getId());
+    }
+
+    bool ok = false;
+    if (name.startsWith("course:") && name.mid(7).toInt(&ok) > 0 && ok) {
+        return name;
+    }
+    return QString();
+}
+
+// Course events are only for members of the course's class. Unsubscribing needs no check, so
+// a user who has left the class can still end the subscription.
+bool ClientHandler::maySubscribe(const QString &topic) const
+{
+    if (!topic.startsWith("course:") || m_currentUser->getUserRole() == UserRole::Admin)
+        return true;
+    return DatabaseManager::instance().isCourseMember(m_currentUser->getId(),
+                                                      topic.mid(7).toInt());
+}
+
+QJsonObject ClientHandler::handleSubscribe(const QJsonObject &data)
+{
+    QJsonArray subscribed;
+    QJsonArray rejected;
+    for (const QJsonValue &value : data["topics"].toArray()) {
+        QString name = value.toString();
+        QString topic = subscriptionTopic(name);
+        if (topic.isEmpty() || !maySubscribe(topic)) {
+            rejected.append(name);
+            continue;
+        }
+        NotificationHub::instance().subscribe(this, topic, name);
+        subscribed.append(name);
+    }
+
+    QJsonObject response;
+    response["type"] = "OK";
+    response["topics"] = subscribed;
+    if (!rejected.isEmpty()) {
+        response["rejected"] = rejected;
+    }
+    return response;
+}
+
+QJsonObject ClientHandler::handleUnsubscribe(const QJsonObject &data)
+{
+    // Without a topic list every subscription ends
+    const QJsonArray topics = data["topics"].toArray();
+    if (topics.isEmpty()) {
+        NotificationHub::instance().unsubscribeAll(this);
+    }
+    for (const QJsonValue &value : topics) {
+        QString topic = subscriptionTopic(value.toString());
+        if (!topic.isEmpty()) {
+            NotificationHub::instance().unsubscribe(this, topic);
+        }
+    }
+
+    QJsonObject response;
+    response["type"] = "OK";
+    return response;
+}
+
+void ClientHandler::pushEvent(const QString &topic, const QJsonObject &event)
+{
+    if (m_disconnected)
         return;
+
+    // Events carry no request_id, which tells the client they weren't asked for
+    QJsonObject message;
+    message["type"] = "EVENT";
+    message["topic"] = topic;
+    message["data"] = event;
+    sendResponse(message);
+}
+
+QJsonObject ClientHandler::handleGetAllUsers(const QJsonObject &data)
+{
+    PageRequest page;
+    if (!PageRequest::fromJson(data, 1, &page)) {
+        return errorResponse("Invalid cursor");
+    }
+
+    QString nextCursor;
+    auto users = DatabaseManager::instance().getAllUsers(page,
+                                                         &nextCursor,
+                                                         data["search"].toString().trimmed());
+    QJsonArray usersArray;
+    for (const auto &user : users) {
+        usersArray.append(user->toJson());
     }
 
+    return pageResponse(usersArray, nextCursor);
+}
+
+QJsonObject ClientHandler::handleCreateUser(const QJsonObject &data)
+{
     QString username = data["username"].toString();
     QString password = data["password"].toString();
     QString role = data["role"].toString();
@@ -242,45 +725,35 @@ void ClientHandler::handleCreateUser(const QJsonObject &data)
         response["type"] = "ERROR";
         response["message"] = "Failed to create user";
     }
-    sendResponse(response);
+    return response;
 }
 
-void ClientHandler::handleDeleteUser(const QJsonObject &data)
+QJsonObject ClientHandler::handleDeleteUser(const QJsonObject &data)
 {
-    if (!m_currentUser || m_currentUser->getRole() != "admin") {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
-        return;
-    }
-
     int userId = data["user_id"].toInt();
     bool success = DatabaseManager::instance().deleteUser(userId);
 
     QJsonObject response;
     if (success) {
+        SessionTokens::instance().revokeUser(userId);
         response["type"] = "OK";
         response["message"] = "User deleted successfully";
     } else {
         response["type"] = "ERROR";
         response["message"] = "Failed to delete user";
     }
-    sendResponse(response);
+    return response;
 }
 
-void ClientHandler::handleGetAllClasses()
+QJsonObject ClientHandler::handleGetAllClasses(const QJsonObject &data)
 {
-    if (!m_currentUser) {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
-        return;
+    qint64 version;
+    if (isUnchanged(data, "classes", &version)) {
+        return notModifiedResponse(version);
     }
 
     QJsonArray classes;
-    if (m_currentUser->getRole() == "admin") {
+    if (m_currentUser->getUserRole() == UserRole::Admin) {
         classes = DatabaseManager::instance().getAllClasses();
     } else {
         classes = DatabaseManager::instance().getClassesForUser(m_currentUser->getId());
@@ -289,19 +762,12 @@ void ClientHandler::handleGetAllClasses()
     QJsonObject response;
     response["type"] = "DATA_RESPONSE";
     response["data"] = classes;
-    sendResponse(response);
+    response["version"] = version;
+    return response;
 }
 
-void ClientHandler::handleCreateClass(const QJsonObject &data)
+QJsonObject ClientHandler::handleCreateClass(const QJsonObject &data)
 {
-    if (!m_currentUser || m_currentUser->getRole() != "admin") {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
-        return;
-    }
-
     QString className = data["class_name"].toString();
     bool success = DatabaseManager::instance().createClass(className);
 
@@ -313,19 +779,11 @@ void ClientHandler::handleCreateClass(const QJsonObject &data)
         response["type"] = "ERROR";
         response["message"] = "Failed to create class";
     }
-    sendResponse(response);
+    return response;
 }
 
-void ClientHandler::handleDeleteClass(const QJsonObject &data)
+QJsonObject ClientHandler::handleDeleteClass(const QJsonObject &data)
 {
-    if (!m_currentUser || m_currentUser->getRole() != "admin") {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
-        return;
-    }
-
     int classId = data["class_id"].toInt();
     bool success = DatabaseManager::instance().deleteClass(classId);
 
@@ -337,19 +795,11 @@ void ClientHandler::handleDeleteClass(const QJsonObject &data)
         response["type"] = "ERROR";
         response["message"] = "Failed to delete class";
     }
-    sendResponse(response);
+    return response;
 }
 
-void ClientHandler::handleAssignUserToClass(const QJsonObject &data)
+QJsonObject ClientHandler::handleAssignUserToClass(const QJsonObject &data)
 {
-    if (!m_currentUser || m_currentUser->getRole() != "admin") {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
-        return;
-    }
-
     int userId = data["user_id"].toInt();
     int classId = data["class_id"].toInt();
     bool success = DatabaseManager::instance().assignUserToClass(userId, classId);
@@ -362,19 +812,11 @@ void ClientHandler::handleAssignUserToClass(const QJsonObject &data)
         response["type"] = "ERROR";
         response["message"] = "Failed to assign user";
     }
-    sendResponse(response);
+    return response;
 }
 
-void ClientHandler::handleRemoveUserFromClass(const QJsonObject &data)
+QJsonObject ClientHandler::handleRemoveUserFromClass(const QJsonObject &data)
 {
-    if (!m_currentUser || m_currentUser->getRole() != "admin") {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
-        return;
-    }
-
     int userId = data["user_id"].toInt();
     int classId = data["class_id"].toInt();
     bool success = DatabaseManager::instance().removeUserFromClass(userId, classId);
@@ -387,57 +829,61 @@ void ClientHandler::handleRemoveUserFromClass(const QJsonObject &data)
         response["type"] = "ERROR";
         response["message"] = "Failed to remove user";
     }
-    sendResponse(response);
+    return response;
 }
 
-void ClientHandler::handleGetClassMembers(const QJsonObject &data)
+QJsonObject ClientHandler::handleGetClassMembers(const QJsonObject &data)
 {
-    if (!m_currentUser || m_currentUser->getRole() != "admin") {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
-        return;
+    int classId = data["class_id"].toInt();
+    PageRequest page;
+    if (!PageRequest::fromJson(data, 1, &page)) {
+        return errorResponse("Invalid cursor");
     }
 
-    int classId = data["class_id"].toInt();
-    QJsonArray members = DatabaseManager::instance().getClassMembers(classId);
+    QString nextCursor;
+    QJsonArray members = DatabaseManager::instance().getClassMembers(classId, page, &nextCursor);
+    return pageResponse(members, nextCursor);
+}
+
+QJsonObject ClientHandler::handleGetClassTree(const QJsonObject &data)
+{
+    // depth 1: classes, 2: with courses, 3: with materials
+    int depth = qBound(1, data["depth"].toInt(3), 3);
+    bool metadataOnly = data["metadata_only"].toBool(true);
+    int userId = m_currentUser->getUserRole() == UserRole::Admin ? -1 : m_currentUser->getId();
+    qint64 version;
+    if (isUnchanged(data, "tree", &version)) {
+        return notModifiedResponse(version);
+    }
+
+    QJsonArray tree = DatabaseManager::instance().getClassTree(userId, depth, !metadataOnly);
 
     QJsonObject response;
     response["type"] = "DATA_RESPONSE";
-    response["data"] = members;
-    sendResponse(response);
+    response["data"] = tree;
+    response["version"] = version;
+    return response;
 }
 
-void ClientHandler::handleGetCoursesForClass(const QJsonObject &data)
+QJsonObject ClientHandler::handleGetCoursesForClass(const QJsonObject &data)
 {
-    if (!m_currentUser) {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
-        return;
+    int classId = data["class_id"].toInt();
+    qint64 version;
+    if (isUnchanged(data, QString("class:%1").arg(classId), &version)) {
+        return notModifiedResponse(version);
     }
 
-    int classId = data["class_id"].toInt();
     QJsonArray courses = DatabaseManager::instance().getCoursesForClass(classId);
 
     QJsonObject response;
     response["type"] = "DATA_RESPONSE";
     response["data"] = courses;
-    sendResponse(response);
+    response["version"] = version;
+    return response;
 }
 
-void ClientHandler::handleCreateCourse(const QJsonObject &data)
+QJsonObject ClientHandler::handleCreateCourse(const QJsonObject &data)
 {
-    if (!m_currentUser || m_currentUser->getRole() != "admin") {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
-        return;
-    }
-
     QString courseName = data["course_name"].toString();
     int classId = data["class_id"].toInt();
     bool success = DatabaseManager::instance().createCourse(courseName, classId);
@@ -450,19 +896,11 @@ void ClientHandler::handleCreateCourse(const QJsonObject &data)
         response["type"] = "ERROR";
         response["message"] = "Failed to create course";
     }
-    sendResponse(response);
+    return response;
 }
 
-void ClientHandler::handleDeleteCourse(const QJsonObject &data)
+QJsonObject ClientHandler::handleDeleteCourse(const QJsonObject &data)
 {
-    if (!m_currentUser || m_currentUser->getRole() != "admin") {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
-        return;
-    }
-
     int courseId = data["course_id"].toInt();
     bool success = DatabaseManager::instance().deleteCourse(courseId);
 
@@ -474,38 +912,28 @@ void ClientHandler::handleDeleteCourse(const QJsonObject &data)
         response["type"] = "ERROR";
         response["message"] = "Failed to delete course";
     }
-    sendResponse(response);
+    return response;
 }
 
-void ClientHandler::handleGetMaterialsForCourse(const QJsonObject &data)
+QJsonObject ClientHandler::handleGetMaterialsForCourse(const QJsonObject &data)
 {
-    if (!m_currentUser) {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
-        return;
+    int courseId = data["course_id"].toInt();
+    qint64 version;
+    if (isUnchanged(data, QString("course:%1").arg(courseId), &version)) {
+        return notModifiedResponse(version);
     }
 
-    int courseId = data["course_id"].toInt();
     QJsonArray materials = DatabaseManager::instance().getMaterialsForCourse(courseId);
 
     QJsonObject response;
     response["type"] = "DATA_RESPONSE";
     response["data"] = materials;
-    sendResponse(response);
+    response["version"] = version;
+    return response;
 }
 
-void ClientHandler::handleCreateLesson(const QJsonObject &data)
+QJsonObject ClientHandler::handleCreateLesson(const QJsonObject &data)
 {
-    if (!m_currentUser || m_currentUser->getRole() != "instructor") {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
-        return;
-    }
-
     QString title = data["title"].toString();
     QString content = data["content"].toString();
     int courseId = data["course_id"].toInt();
@@ -521,18 +949,11 @@ void ClientHandler::handleCreateLesson(const QJsonObject &data)
         response["type"] = "ERROR";
         response["message"] = "Failed to create lesson";
     }
-    sendResponse(response);
+    return response;
 }
 
-void ClientHandler::handleCreateQuizWithQuestions(const QJsonObject &data)
+QJsonObject ClientHandler::handleCreateQuizWithQuestions(const QJsonObject &data)
 {
-    if (!m_currentUser || m_currentUser->getRole() != "instructor") {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
-        return;
-    }
     int courseId = data["course_id"].toInt();
     int creatorId = m_currentUser->getId();
     bool success = DatabaseManager::instance().createQuizWithQuestions(data, courseId, creatorId);
@@ -545,19 +966,11 @@ void ClientHandler::handleCreateQuizWithQuestions(const QJsonObject &data)
         response["type"] = "ERROR";
         response["message"] = "Failed to create quiz";
     }
-    sendResponse(response);
+    return response;
 }
 
-void ClientHandler::handleDeleteMaterial(const QJsonObject &data)
+QJsonObject ClientHandler::handleDeleteMaterial(const QJsonObject &data)
 {
-    if (!m_currentUser || m_currentUser->getRole() != "instructor") {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
-        return;
-    }
-
     int materialId = data["material_id"].toInt();
     bool success = DatabaseManager::instance().deleteMaterial(materialId);
 
@@ -569,110 +982,98 @@ void ClientHandler::handleDeleteMaterial(const QJsonObject &data)
         response["type"] = "ERROR";
         response["message"] = "Failed to delete material";
     }
-    sendResponse(response);
+    return response;
 }
 
-void ClientHandler::handleGetMaterialDetails(const QJsonObject &data)
+QJsonObject ClientHandler::handleGetMaterialDetails(const QJsonObject &data)
 {
     int materialId = data["material_id"].toInt();
+    qint64 version;
+    if (isUnchanged(data, QString("material:%1").arg(materialId), &version)) {
+        return notModifiedResponse(version);
+    }
+
     auto material = DatabaseManager::instance().getMaterialById(materialId);
 
     if (material) {
         QJsonObject response;
         response["type"] = "DATA_RESPONSE";
-        response["data"] = material->toJson(m_currentUser->getRole() == "instructor");
-        sendResponse(response);
+        response["data"] = material->toJson(m_currentUser->getUserRole() == UserRole::Instructor);
+        response["version"] = version;
+        return response;
     } else {
         QJsonObject response;
         response["type"] = "ERROR";
         response["message"] = "Material not found";
-        sendResponse(response);
+        return response;
     }
 }
 
-void ClientHandler::handleStartQuiz(const QJsonObject &data)
+QJsonObject ClientHandler::handleGetLessonChunk(const QJsonObject &data)
 {
-    if (!m_currentUser || m_currentUser->getRole() != "student") {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
-        return;
+    int materialId = data["material_id"].toInt();
+    qint64 offset = qMax<qint64>(0, data["offset"].toInteger());
+    int length = qBound(1, data["length"].toInt(DefaultChunkLength), MaxChunkLength);
+    // Clients revalidate a kept lesson with the first chunk and need no others if it's current
+    qint64 version;
+    if (isUnchanged(data, QString("material:%1").arg(materialId), &version)) {
+        return notModifiedResponse(version);
     }
 
+    QJsonObject chunk = DatabaseManager::instance().getLessonChunk(materialId, offset, length);
+    if (chunk.isEmpty()) {
+        return errorResponse("Lesson not found");
+    }
+
+    QJsonObject response;
+    response["type"] = "DATA_RESPONSE";
+    response["data"] = chunk;
+    response["version"] = version;
+    return response;
+}
+
+QJsonObject ClientHandler::handleStartQuiz(const QJsonObject &data)
+{
     int quizId = data["quiz_id"].toInt();
 
     // Get quiz details
-    auto quiz = DatabaseManager::instance().getMaterialById(quizId);
-    if (!quiz || quiz->getType() != "quiz") {
+    auto quiz = DatabaseManager::instance().getQuiz(quizId);
+    if (!quiz) {
         QJsonObject response;
         response["type"] = "ERROR";
         response["message"] = "Quiz not found";
-        sendResponse(response);
-        return;
+        return response;
     }
 
     // Check attempt count
     int attemptCount = DatabaseManager::instance().getAttemptCount(quizId, m_currentUser->getId());
-    auto quizPtr = std::dynamic_pointer_cast<Quiz>(quiz);
-    if (quizPtr && attemptCount >= quizPtr->getMaxAttempts()) {
+    if (attemptCount >= quiz->getMaxAttempts()) {
         QJsonObject response;
         response["type"] = "ERROR";
         response["message"] = "You have reached the maximum number of attempts for this quiz.";
-        sendResponse(response);
-        return;
+        return response;
     }
 
     QJsonObject response;
     response["type"] = "DATA_RESPONSE";
     response["data"] = quiz->toJson(false); // Pass false to exclude answers
-    sendResponse(response);
+    return response;
 }
 
-void ClientHandler::handleFinishAttempt(const QJsonObject &data)
+QJsonObject ClientHandler::handleFinishAttempt(const QJsonObject &data)
 {
-    if (!m_currentUser || m_currentUser->getRole() != "student") {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
-        return;
-    }
-
     int quizId = data["quiz_id"].toInt();
     QJsonArray answers = data["answers"].toArray();
 
-    int attemptNumber = DatabaseManager::instance().getAttemptCount(quizId, m_currentUser->getId())
-                        + 1;
-    int attemptId = DatabaseManager::instance().createQuizAttempt(quizId,
-                                                                  m_currentUser->getId(),
-                                                                  attemptNumber);
-
-    if (attemptId < 0) {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Failed to create quiz attempt";
-        sendResponse(response);
-        return;
-    }
-
-    // Save answers
-    for (const QJsonValue &val : answers) {
-        QJsonObject answer = val.toObject();
-        DatabaseManager::instance().saveAnswer(attemptId,
-                                               answer["question_id"].toInt(),
-                                               answer["response"].toString());
-    }
-
-    // Auto-grade the attempt
-    QJsonObject gradeResult = DatabaseManager::instance().autoGradeQuizAttempt(attemptId);
+    QJsonObject gradeResult = DatabaseManager::instance().submitQuizAttempt(quizId,
+                                                                            m_currentUser->getId(),
+                                                                            answers);
 
     if (!gradeResult["success"].toBool()) {
         QJsonObject response;
         response["type"] = "ERROR";
-        response["message"] = "Failed to grade quiz attempt";
-        sendResponse(response);
-        return;
+        response["message"] = "Failed to submit quiz attempt";
+        return response;
     }
 
     QJsonObject response;
@@ -682,41 +1083,30 @@ void ClientHandler::handleFinishAttempt(const QJsonObject &data)
     response["auto_score"] = gradeResult["auto_score"].toDouble();
     response["has_open_answers"] = gradeResult["has_open_answers"].toBool();
     response["feedback_type"] = gradeResult["feedback_type"].toString();
-    sendResponse(response);
+    return response;
 }
 
-void ClientHandler::handleGetMyAttempts()
+QJsonObject ClientHandler::handleGetMyAttempts(const QJsonObject &data)
 {
-    if (!m_currentUser || m_currentUser->getRole() != "student") {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
-        return;
+    PageRequest page;
+    if (!PageRequest::fromJson(data, 2, &page)) {
+        return errorResponse("Invalid cursor");
     }
 
-    QJsonArray attempts = DatabaseManager::instance().getStudentQuizAttempts(m_currentUser->getId());
-
-    QJsonObject response;
-    response["type"] = "DATA_RESPONSE";
-    response["data"] = attempts;
-    sendResponse(response);
+    QString nextCursor;
+    QJsonArray attempts = DatabaseManager::instance().getStudentQuizAttempts(m_currentUser->getId(),
+                                                                             page,
+                                                                             &nextCursor);
+    return pageResponse(attempts, nextCursor);
 }
 
-void ClientHandler::handleGetAttemptDetails(const QJsonObject &data)
+QJsonObject ClientHandler::handleGetAttemptDetails(const QJsonObject &data)
 {
-    if (!m_currentUser) {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
-        return;
-    }
-
     int attemptId = data["attempt_id"].toInt();
 
     // Students can only view their own attempts
-    int studentId = m_currentUser->getRole() == "student" ? m_currentUser->getId() : -1;
+    int studentId = m_currentUser->getUserRole() == UserRole::Student ? m_currentUser->getId()
+                                                                      : -1;
 
     QJsonObject attemptDetails = DatabaseManager::instance().getQuizAttemptDetails(attemptId,
                                                                                    studentId);
@@ -725,101 +1115,68 @@ void ClientHandler::handleGetAttemptDetails(const QJsonObject &data)
         QJsonObject response;
         response["type"] = "ERROR";
         response["message"] = "Attempt not found or access denied";
-        sendResponse(response);
-        return;
+        return response;
     }
 
     QJsonObject response;
     response["type"] = "DATA_RESPONSE";
     response["data"] = attemptDetails;
-    sendResponse(response);
+    return response;
 }
 
-void ClientHandler::handleGetPendingAttempts()
+QJsonObject ClientHandler::handleGetPendingAttempts(const QJsonObject &data)
 {
-    if (!m_currentUser || m_currentUser->getRole() != "instructor") {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
-        return;
+    PageRequest page;
+    if (!PageRequest::fromJson(data, 2, &page)) {
+        return errorResponse("Invalid cursor");
     }
 
-    QJsonArray attempts = DatabaseManager::instance().getPendingAttempts(m_currentUser->getId());
-
-    QJsonObject response;
-    response["type"] = "DATA_RESPONSE";
-    response["data"] = attempts;
-    sendResponse(response);
+    QString nextCursor;
+    QJsonArray attempts = DatabaseManager::instance().getPendingAttempts(m_currentUser->getId(),
+                                                                         page,
+                                                                         &nextCursor);
+    return pageResponse(attempts, nextCursor);
 }
 
-void ClientHandler::handleGetStudentAttemptsForQuiz(const QJsonObject &data)
+QJsonObject ClientHandler::handleGetStudentAttemptsForQuiz(const QJsonObject &data)
 {
-    if (!m_currentUser || m_currentUser->getRole() != "instructor") {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
-        return;
-    }
-
     int quizId = data["quiz_id"].toInt();
-    QJsonArray attempts = DatabaseManager::instance().getStudentAttemptsForQuiz(quizId);
+    PageRequest page;
+    if (!PageRequest::fromJson(data, 2, &page)) {
+        return errorResponse("Invalid cursor");
+    }
 
-    QJsonObject response;
-    response["type"] = "DATA_RESPONSE";
-    response["data"] = attempts;
-    sendResponse(response);
+    QString nextCursor;
+    QJsonArray attempts = DatabaseManager::instance().getStudentAttemptsForQuiz(quizId,
+                                                                                page,
+                                                                                &nextCursor);
+    return pageResponse(attempts, nextCursor);
 }
 
-void ClientHandler::handleGetClassStatistics(const QJsonObject &data)
+QJsonObject ClientHandler::handleGetClassStatistics(const QJsonObject &data)
 {
-    if (!m_currentUser || m_currentUser->getRole() != "instructor") {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
-        return;
-    }
-
     int classId = data["class_id"].toInt();
     QJsonObject stats = DatabaseManager::instance().getClassStatistics(classId);
 
     QJsonObject response;
     response["type"] = "DATA_RESPONSE";
     response["data"] = stats;
-    sendResponse(response);
+    return response;
 }
 
-void ClientHandler::handleGetCourseStatistics(const QJsonObject &data)
+QJsonObject ClientHandler::handleGetCourseStatistics(const QJsonObject &data)
 {
-    if (!m_currentUser || m_currentUser->getRole() != "instructor") {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
-        return;
-    }
-
     int courseId = data["course_id"].toInt();
     QJsonObject stats = DatabaseManager::instance().getCourseStatistics(courseId);
 
     QJsonObject response;
     response["type"] = "DATA_RESPONSE";
     response["data"] = stats;
-    sendResponse(response);
+    return response;
 }
 
-void ClientHandler::handleSubmitGrade(const QJsonObject &data)
+QJsonObject ClientHandler::handleSubmitGrade(const QJsonObject &data)
 {
-    if (!m_currentUser || m_currentUser->getRole() != "instructor") {
-        QJsonObject response;
-        response["type"] = "ERROR";
-        response["message"] = "Unauthorized";
-        sendResponse(response);
-        return;
-    }
-
     int attemptId = data["attempt_id"].toInt();
     int questionId = data["question_id"].toInt();
     float score = data["score"].toDouble();
@@ -834,5 +1191,5 @@ void ClientHandler::handleSubmitGrade(const QJsonObject &data)
         response["type"] = "ERROR";
         response["message"] = "Failed to submit grade";
     }
-    sendResponse(response);
+    return response;
 }
@@ -1,21 +1,33 @@
 #ifndef CLIENTHANDLER_H
 #define CLIENTHANDLER_H
 
+#include "admissioncontroller.h"
+#include "messagecodec.h"
+#include "serveroptions.h"
+#include "tokenbucket.h"
+#include "user.h"
 #include <memory>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonArray>
 #include <QJsonObject>
 #include <QObject>
+#include <QQueue>
 #include <QSslSocket>
 
-class User;
-
 class ClientHandler : public QObject
 {
     Q_OBJECT
 
 public:
-    explicit ClientHandler(QSslSocket *socket, QObject *parent = nullptr);
+    explicit ClientHandler(QSslSocket *socket,
+                           const ServerOptions &options,
+                           QObject *parent = nullptr);
     ~ClientHandler();
 
+    // Sends a subscribed change event to the client; called on the handler's thread
+    void pushEvent(const QString &topic, const QJsonObject &event);
+
 signals:
     void logMessage(const QString &message);
     void clientDisconnected(ClientHandler *handler);
@@ -25,45 +37,119 @@ public slots:
 
 private slots:
     void onReadyRead();
+    void onBytesWritten();
     void onDisconnected();
     void onSslErrors(const QList<QSslError> &errors);
 
 private:
-    void processMessage(const QJsonObject &message);
+    using CommandHandler = QJsonObject (ClientHandler::*)(const QJsonObject &data);
+
+    // Declarative description of a protocol command; the table is looked up once per request
+    struct CommandSpec
+    {
+        CommandHandler handler;
+        bool requiresAuth;
+        UserRoles roles;         // Roles allowed to run the command when requiresAuth is set
+        int timeoutMs = 5000;    // Executor time after which the command is logged as slow
+        CommandPriority priority = CommandPriority::Interactive;
+        bool exclusive = false;  // Waits for, and holds back, every other command of the client
+    };
+
+    static constexpr int MaxBatchSize = 256;
+    static constexpr int PriorityCount = 3;
+    static constexpr int DefaultChunkLength = 16384; // Characters of lesson text per chunk
+    static constexpr int MaxChunkLength = 262144;
+    // Decrypted request bytes buffered while reads are paused; beyond it TCP flow control kicks in
+    static constexpr qint64 PausedReadBufferSize = 64 * 1024;
+
+    static const QHash<QString, CommandSpec> &commandTable();
+    static const CommandSpec *findCommand(const QString &command);
+    static bool allowedInBatch(const CommandSpec *spec);
+    static QJsonObject errorResponse(const QString &message);
+    // DATA_RESPONSE for one page of a list command; next_cursor is set while more rows follow
+    static QJsonObject pageResponse(const QJsonArray &rows, const QString &nextCursor);
+    // Sets version to the key's current stamp and tells whether the request's if_version
+    // matches it, in which case the handler answers notModifiedResponse() without a lookup
+    static bool isUnchanged(const QJsonObject &data, const QString &key, qint64 *version);
+    static QJsonObject notModifiedResponse(qint64 version);
+    // Tells the client to send the command again after retryAfterMs
+    static QJsonObject busyResponse(int retryAfterMs, const QString &message);
+
+    void processNextMessage();
+    bool canStart(const QJsonObject &message) const;
+    // Applies the client's rate limit and the server's admission control to a command about to
+    // start. Returns the BUSY or ERROR response for a rejected command, an empty object
+    // otherwise.
+    QJsonObject checkAdmission(const CommandSpec *spec, const QJsonObject &data);
+    void updateInputPause();
+    void startCommand(const QJsonObject &message);
+    QJsonObject dispatch(const CommandSpec *spec, const QJsonObject &data);
+    // Appends to the output buffer; see flushOutput()
     void sendResponse(const QJsonObject &response);
+    void flushOutput();
+    qsizetype pendingOutput() const;
 
     // Command handlers
-    void handleLogin(const QJsonObject &data);
-    void handleLogout();
-    void handleCreateUser(const QJsonObject &data);
-    void handleDeleteUser(const QJsonObject &data);
-    void handleGetAllUsers();
-    void handleGetAllClasses();
-    void handleCreateClass(const QJsonObject &data);
-    void handleDeleteClass(const QJsonObject &data);
-    void handleAssignUserToClass(const QJsonObject &data);
-    void handleRemoveUserFromClass(const QJsonObject &data);
-    void handleGetClassMembers(const QJsonObject &data);
-    void handleGetCoursesForClass(const QJsonObject &data);
-    void handleCreateCourse(const QJsonObject &data);
-    void handleDeleteCourse(const QJsonObject &data);
-    void handleGetMaterialsForCourse(const QJsonObject &data);
-    void handleGetMaterialDetails(const QJsonObject &data);
-    void handleDeleteMaterial(const QJsonObject &data);
-    void handleCreateLesson(const QJsonObject &data);
-    void handleCreateQuizWithQuestions(const QJsonObject &data);
-    void handleStartQuiz(const QJsonObject &data);
-    void handleFinishAttempt(const QJsonObject &data);
-    void handleGetPendingAttempts();
-    void handleGetMyAttempts();
-    void handleGetAttemptDetails(const QJsonObject &data);
-    void handleGetStudentAttemptsForQuiz(const QJsonObject &data);
-    void handleSubmitGrade(const QJsonObject &data);
-    void handleGetClassStatistics(const QJsonObject &data);
-    void handleGetCourseStatistics(const QJsonObject &data);
+    QJsonObject handleHello(const QJsonObject &data);
+    QJsonObject handleLogin(const QJsonObject &data);
+    QJsonObject handleLogout(const QJsonObject &data);
+    QJsonObject handleResumeSession(const QJsonObject &data);
+    QJsonObject handleBatch(const QJsonObject &data);
+    QJsonObject handleSubscribe(const QJsonObject &data);
+    QJsonObject handleUnsubscribe(const QJsonObject &data);
+    QString subscriptionTopic(const QString &name) const;
+    bool maySubscribe(const QString &topic) const;
+    QJsonObject handleCreateUser(const QJsonObject &data);
+    QJsonObject handleDeleteUser(const QJsonObject &data);
+    QJsonObject handleGetAllUsers(const QJsonObject &data);
+    QJsonObject handleGetAllClasses(const QJsonObject &data);
+    QJsonObject handleCreateClass(const QJsonObject &data);
+    QJsonObject handleDeleteClass(const QJsonObject &data);
+    QJsonObject handleAssignUserToClass(const QJsonObject &data);
+    QJsonObject handleRemoveUserFromClass(const QJsonObject &data);
+    QJsonObject handleGetClassMembers(const QJsonObject &data);
+    QJsonObject handleGetClassTree(const QJsonObject &data);
+    QJsonObject handleGetCoursesForClass(const QJsonObject &data);
+    QJsonObject handleCreateCourse(const QJsonObject &data);
+    QJsonObject handleDeleteCourse(const QJsonObject &data);
+    QJsonObject handleGetMaterialsForCourse(const QJsonObject &data);
+    QJsonObject handleGetMaterialDetails(const QJsonObject &data);
+    QJsonObject handleGetLessonChunk(const QJsonObject &data);
+    QJsonObject handleDeleteMaterial(const QJsonObject &data);
+    QJsonObject handleCreateLesson(const QJsonObject &data);
+    QJsonObject handleCreateQuizWithQuestions(const QJsonObject &data);
+    QJsonObject handleStartQuiz(const QJsonObject &data);
+    QJsonObject handleFinishAttempt(const QJsonObject &data);
+    QJsonObject handleGetPendingAttempts(const QJsonObject &data);
+    QJsonObject handleGetMyAttempts(const QJsonObject &data);
+    QJsonObject handleGetAttemptDetails(const QJsonObject &data);
+    QJsonObject handleGetStudentAttemptsForQuiz(const QJsonObject &data);
+    QJsonObject handleSubmitGrade(const QJsonObject &data);
+    QJsonObject handleGetClassStatistics(const QJsonObject &data);
+    QJsonObject handleGetCourseStatistics(const QJsonObject &data);
 
     QSslSocket *m_socket;
-    QByteArray m_buffer;
+    MessageCodec m_codec;
+    qsizetype m_compressionThreshold;
+    // Settings agreed on by HELLO, applied once its reply has been written
+    MessageCodec::Format m_negotiatedFormat = MessageCodec::Format::Json;
+    bool m_negotiatedCompression = false;
+    QQueue<QJsonObject> m_pendingMessages;
+    int m_maxQueuedCommands;
+    qsizetype m_maxQueuedBytes;
+    bool m_inputPaused = false; // Too many requests waiting; the rest stay in the socket
+    TokenBucket m_rateLimits[PriorityCount]; // Indexed by CommandPriority
+    QElapsedTimer m_clock;
+    int m_maxPipelined;
+    // Responses queued since the last flush; written together once the event loop is idle
+    QByteArray m_outputBuffer;
+    bool m_flushScheduled = false;
+    qsizetype m_outputHighWater;
+    qsizetype m_outputLowWater;
+    bool m_readsPaused = false; // Too much unsent output; requests wait in the socket
+    int m_commandsInFlight = 0;
+    bool m_serialInFlight = false;
+    bool m_disconnected = false;
     std::shared_ptr<User> m_currentUser;
 };
 
@@ -0,0 +1,128 @@
+#include "commandscheduler.h"
+
+CommandScheduler::CommandScheduler()
+{
+    m_executor.setObjectName("DatabaseExecutor");
+    // The threads keep the database connections they opened, so they must not come and go
+    m_executor.setExpiryTimeout(-1);
+    m_clock.start();
+}
+
+CommandScheduler::~CommandScheduler()
+{
+    waitForDone();
+}
+
+void CommandScheduler::configure(int threads, int criticalReserve, int bulkThreads)
+{
+    QMutexLocker locker(&m_mutex);
+    m_threads = qMax(1, threads);
+    m_criticalReserve = qBound(0, criticalReserve, m_threads - 1);
+    m_bulkLimit = qBound(1, bulkThreads, m_threads - m_criticalReserve);
+    m_executor.setMaxThreadCount(m_threads);
+
+    // A larger configuration may let queued work start right away
+    startJobs();
+}
+
+int CommandScheduler::threadCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_threads;
+}
+
+void CommandScheduler::waitForDone()
+{
+    // Finishing jobs start the queued ones before their thread becomes idle
+    m_executor.waitForDone();
+}
+
+void CommandScheduler::enqueue(CommandPriority priority, std::function<void()> work)
+{
+    int index = static_cast<int>(priority);
+
+    QMutexLocker locker(&m_mutex);
+    m_queues[index].enqueue({std::move(work), m_clock.elapsed()});
+    m_peakQueued[index] = qMax(m_peakQueued[index], int(m_queues[index].size()));
+    startJobs();
+}
+
+bool CommandScheduler::hasFreeThread(int priority) const
+{
+    int running = m_running[0] + m_running[1] + m_running[2];
+    if (running >= m_threads)
+        return false;
+    if (priority == static_cast<int>(CommandPriority::Critical))
+        return true;
+
+    int nonCritical = running - m_running[static_cast<int>(CommandPriority::Critical)];
+    if (nonCritical >= m_threads - m_criticalReserve)
+        return false;
+    return priority != static_cast<int>(CommandPriority::Bulk) || m_running[priority] < m_bulkLimit;
+}
+
+int CommandScheduler::nextClass(qint64 nowMs) const
+{
+    const int critical = static_cast<int>(CommandPriority::Critical);
+    const int interactive = static_cast<int>(CommandPriority::Interactive);
+    const int bulk = static_cast<int>(CommandPriority::Bulk);
+
+    if (!m_queues[critical].isEmpty() && hasFreeThread(critical))
+        return critical;
+
+    bool bulkReady = !m_queues[bulk].isEmpty() && hasFreeThread(bulk);
+    if (bulkReady && nowMs - m_queues[bulk].head().queuedAtMs >= BulkStarvationMs)
+        return bulk;
+    if (!m_queues[interactive].isEmpty() && hasFreeThread(interactive))
+        return interactive;
+    return bulkReady ? bulk : -1;
+}
+
+void CommandScheduler::startJobs()
+{
+    qint64 now = m_clock.elapsed();
+    for (int priority = nextClass(now); priority >= 0; priority = nextClass(now)) {
+        Job job = m_queues[priority].dequeue();
+        qint64 waitMs = now - job.queuedAtMs;
+        m_waitMsTotal[priority] += waitMs;
+        m_waitMsMax[priority] = qMax(m_waitMsMax[priority], waitMs);
+        ++m_running[priority];
+
+        m_executor.start([this, priority, work = std::move(job.work)]() {
+            work();
+            finished(priority);
+        });
+    }
+}
+
+void CommandScheduler::finished(int priority)
+{
+    QMutexLocker locker(&m_mutex);
+    --m_running[priority];
+    ++m_completed[priority];
+    startJobs();
+}
+
+QJsonObject CommandScheduler::statistics() const
+{
+    static const char *names[PriorityCount] = {"critical", "interactive", "bulk"};
+
+    QMutexLocker locker(&m_mutex);
+    QJsonObject stats;
+    stats["threads"] = m_threads;
+    stats["critical_reserve"] = m_criticalReserve;
+    stats["bulk_limit"] = m_bulkLimit;
+    for (int i = 0; i < PriorityCount; ++i) {
+        QJsonObject queue;
+        queue["running"] = m_running[i];
+        queue["queued"] = int(m_queues[i].size());
+        queue["peak_queued"] = m_peakQueued[i];
+        queue["completed"] = static_cast<double>(m_completed[i]);
+        queue["avg_wait_ms"] = m_completed[i] + m_running[i] > 0
+                                   ? double(m_waitMsTotal[i]) / (m_completed[i] + m_running[i])
+                                   : 0.0;
+        queue["max_wait_ms"] = static_cast<double>(m_waitMsMax[i]);
+        stats[names[i]] = queue;
+    }
+    return stats;
+}
@@ -0,0 +1,90 @@
+#ifndef COMMANDSCHEDULER_H
+#define COMMANDSCHEDULER_H
+
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QJsonObject>
+#include <QMutex>
+#include <QPromise>
+#include <QQueue>
+#include <QThreadPool>
+
+// How a command fares when the server is short on capacity
+enum class CommandPriority {
+    Critical,    // Session handling and submissions; never shed
+    Interactive, // What a user is waiting for
+    Bulk,        // Reports and large listings; shed first
+};
+
+// Runs database work on a fixed set of threads, one per pooled connection, with a queue per
+// command priority. Free threads go to critical work first, then interactive, then bulk.
+// Interactive and bulk work may never take the threads reserved for critical work, and bulk work
+// is further capped at its own share, so a quiz submission finds a connection even while every
+// instructor's dashboard is refreshing. Running work is never interrupted; lower priorities are
+// only deferred.
+class CommandScheduler
+{
+public:
+    CommandScheduler();
+    ~CommandScheduler();
+
+    // threads is the executor size. criticalReserve threads are kept for critical work and bulk
+    // work uses at most bulkThreads; both are clamped so every class can make progress.
+    void configure(int threads, int criticalReserve, int bulkThreads);
+    int threadCount() const;
+
+    // Queues function and returns the future of its result
+    template<typename Function>
+    auto run(CommandPriority priority, Function &&function)
+    {
+        using Result = std::invoke_result_t<std::decay_t<Function>>;
+        auto promise = std::make_shared<QPromise<Result>>();
+        QFuture<Result> future = promise->future();
+        promise->start();
+        enqueue(priority, [promise, function = std::forward<Function>(function)]() mutable {
+            promise->addResult(function());
+            promise->finish();
+        });
+        return future;
+    }
+
+    void waitForDone();
+
+    QJsonObject statistics() const;
+
+private:
+    static constexpr int PriorityCount = 3;
+    // Bulk work that has waited this long goes ahead of queued interactive work, within its share
+    static constexpr qint64 BulkStarvationMs = 5000;
+
+    struct Job
+    {
+        std::function<void()> work;
+        qint64 queuedAtMs;
+    };
+
+    void enqueue(CommandPriority priority, std::function<void()> work);
+    // Starts queued jobs while their class has a free thread; called with m_mutex held
+    void startJobs();
+    bool hasFreeThread(int priority) const;
+    int nextClass(qint64 nowMs) const;
+    void finished(int priority);
+
+    QThreadPool m_executor;
+    QElapsedTimer m_clock;
+    mutable QMutex m_mutex;
+    QQueue<Job> m_queues[PriorityCount];
+    int m_running[PriorityCount] = {};
+    int m_threads = 1;
+    int m_criticalReserve = 0;
+    int m_bulkLimit = 1;
+    quint64 m_completed[PriorityCount] = {};
+    qint64 m_waitMsTotal[PriorityCount] = {};
+    qint64 m_waitMsMax[PriorityCount] = {};
+    int m_peakQueued[PriorityCount] = {};
+};
+
+#endif // COMMANDSCHEDULER_H
@@ -0,0 +1,501 @@
+#include "connectionpool.h"
+#include <utility>
+#include <QDeadlineTimer>
+#include <QDebug>
+#include <QHash>
+#include <QSqlError>
+
+struct ConnectionPool::Connection
+{
+    QString name;
+    QSqlDatabase db;
+    QThread *thread; // Opened the connection; the only thread that may borrow it
+    bool inTransaction = false; // The driver doesn't track it, so PooledConnection does
+    QElapsedTimer lastUsed;
+    QHash<QString, QSqlQuery *> statements;
+    QList<QSqlQuery *> uncached; // Statements that failed to prepare, freed on release
+};
+
+namespace {
+
+// Connection pinned to the current thread by a ConnectionScope
+struct PinnedConnection
+{
+    ConnectionPool *pool = nullptr;
+    ConnectionPool::Connection *connection = nullptr;
+};
+
+thread_local PinnedConnection t_pinned;
+
+} // namespace
+
+ConnectionPool::ConnectionPool() {}
+
+ConnectionPool::~ConnectionPool()
+{
+    shutdown();
+}
+
+bool ConnectionPool::initialize(const ConnectionPoolOptions &options)
+{
+    m_options = options;
+    m_options.maxConnections = qMax(1, m_options.maxConnections);
+    m_options.minConnections = qBound(0, m_options.minConnections, m_options.maxConnections);
+
+    // Pooled connections can't be opened here, since they belong to the threads that use them.
+    // A throwaway one checks the settings so a misconfigured server fails at startup.
+    Connection *probe = openConnection();
+    if (!probe) {
+        return false;
+    }
+    destroyConnection(probe);
+
+    QMutexLocker locker(&m_mutex);
+    m_shuttingDown = false;
+
+    qInfo() << "Database connection pool ready: max" << m_options.maxConnections
+            << "connections";
+    return true;
+}
+
+void ConnectionPool::shutdown()
+{
+    QList<Connection *> idle;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_shuttingDown = true;
+        idle.swap(m_idle);
+        m_totalCount -= idle.size();
+        idle.append(m_retired);
+        m_retired.clear();
+        m_connectionReleased.wakeAll();
+    }
+
+    // The one exception to closing connections on their own thread: the executor has finished
+    // by now and its threads, which have no event loop to post to, never borrow again
+    for (Connection *connection : idle) {
+        destroyConnection(connection);
+    }
+}
+
+PooledConnection ConnectionPool::acquire()
+{
+    if (t_pinned.pool == this) {
+        return PooledConnection(this, t_pinned.connection, false);
+    }
+
+    QThread *thread = QThread::currentThread();
+    QDeadlineTimer deadline(m_options.acquireTimeoutMs);
+    QMutexLocker locker(&m_mutex);
+    ++m_checkouts;
+
+    // Connections of this thread that another thread retired while they were idle
+    QList<Connection *> retired = takeRetired(thread);
+    if (!retired.isEmpty()) {
+        locker.unlock();
+        for (Connection *connection : retired) {
+            destroyConnection(connection);
+        }
+        locker.relock();
+    }
+
+    while (!m_shuttingDown) {
+        if (Connection *connection = takeIdle(thread)) {
+            ++m_inUseCount;
+            locker.unlock();
+
+            if (validate(connection)) {
+                return PooledConnection(this, connection, true);
+            }
+
+            discard(connection);
+            locker.relock();
+            continue;
+        }
+
+        if (m_totalCount < m_options.maxConnections) {
+            ++m_totalCount;
+            ++m_inUseCount;
+            locker.unlock();
+
+            if (Connection *connection = openConnection()) {
+                return PooledConnection(this, connection, true);
+            }
+
+            locker.relock();
+            --m_totalCount;
+            --m_inUseCount;
+            m_connectionReleased.wakeOne();
+            return PooledConnection();
+        }
+
+        // The idle connections belong to other threads. Retire the least recently used one;
+        // only its owner may close it.
+        if (!m_idle.isEmpty()) {
+            m_retired.append(m_idle.takeFirst());
+            --m_totalCount;
+            ++m_evictions;
+            continue;
+        }
+
+        ++m_waits;
+        ++m_waitingCount;
+        bool signalled = m_connectionReleased.wait(&m_mutex, deadline);
+        --m_waitingCount;
+
+        if (!signalled && m_idle.isEmpty() && m_totalCount >= m_options.maxConnections) {
+            ++m_timeouts;
+            qWarning() << "Timed out after" << m_options.acquireTimeoutMs
+                       << "ms waiting for a database connection";
+            return PooledConnection();
+        }
+    }
+
+    return PooledConnection();
+}
+
+QJsonObject ConnectionPool::statistics() const
+{
+    QMutexLocker locker(&m_mutex);
+    QJsonObject stats;
+    stats["open"] = m_totalCount;
+    stats["idle"] = m_idle.size();
+    stats["in_use"] = m_inUseCount;
+    stats["waiting"] = m_waitingCount;
+    stats["min"] = m_options.minConnections;
+    stats["max"] = m_options.maxConnections;
+    stats["checkouts"] = static_cast<double>(m_checkouts);
+    stats["waits"] = static_cast<double>(m_waits);
+    stats["timeouts"] = static_cast<double>(m_timeouts);
+    stats["validation_failures"] = static_cast<double>(m_validationFailures);
+    stats["evictions"] = static_cast<double>(m_evictions);
+    stats["retired"] = m_retired.size();
+    stats["prepared_statements"] = m_preparedStatements.loadRelaxed();
+    stats["statement_hits"] = static_cast<double>(m_statementHits.loadRelaxed());
+    stats["statement_misses"] = static_cast<double>(m_statementMisses.loadRelaxed());
+    return stats;
+}
+
+ConnectionPool::Connection *ConnectionPool::openConnection()
+{
+    QString name;
+    {
+        QMutexLocker locker(&m_mutex);
+        name = QString("QLMSConnection_%1").arg(m_nextConnectionId++);
+    }
+
+    auto *connection = new Connection;
+    connection->name = name;
+    connection->thread = QThread::currentThread();
+    connection->db = QSqlDatabase::addDatabase("QPSQL", name);
+    connection->db.setHostName(m_options.host);
+    connection->db.setPort(m_options.port);
+    connection->db.setDatabaseName(m_options.databaseName);
+    connection->db.setUserName(m_options.username);
+    connection->db.setPassword(m_options.password);
+
+    if (!connection->db.open()) {
+        qCritical() << "Failed to open database connection:" << connection->db.lastError().text();
+        destroyConnection(connection);
+        return nullptr;
+    }
+
+    connection->lastUsed.start();
+    return connection;
+}
+
+bool ConnectionPool::validate(Connection *connection)
+{
+    if (connection->db.isOpen()
+        && !connection->lastUsed.hasExpired(m_options.validationIntervalMs)) {
+        return true;
+    }
+
+    // The connection sat idle long enough that the server or a firewall may have dropped it
+    if (connection->db.isOpen()) {
+        QSqlQuery ping(connection->db);
+        if (ping.exec("SELECT 1")) {
+            return true;
+        }
+    }
+
+    {
+        QMutexLocker locker(&m_mutex);
+        ++m_validationFailures;
+    }
+    qWarning() << "Database connection" << connection->name << "failed liveness check, reopening";
+
+    // Server-side prepared statements die with the session
+    clearStatements(connection);
+    connection->db.close();
+    if (!connection->db.open()) {
+        qWarning() << "Failed to reopen database connection:" << connection->db.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+void ConnectionPool::release(Connection *connection)
+{
+    connection->lastUsed.start();
+
+    // Drop result sets so idle connections don't hold on to rows the borrower already read
+    finishStatements(connection);
+    rollbackAbandoned(connection);
+
+    QList<Connection *> expired;
+    {
+        QMutexLocker locker(&m_mutex);
+        --m_inUseCount;
+
+        if (m_shuttingDown) {
+            --m_totalCount;
+            expired.append(connection);
+        } else {
+            m_idle.append(connection);
+            expired = takeExpiredIdle(connection->thread);
+            expired.append(takeRetired(connection->thread));
+            m_connectionReleased.wakeOne();
+        }
+    }
+
+    for (Connection *c : expired) {
+        destroyConnection(c);
+    }
+}
+
+void ConnectionPool::discard(Connection *connection)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        --m_inUseCount;
+        --m_totalCount;
+        m_connectionReleased.wakeOne();
+    }
+    destroyConnection(connection);
+}
+
+// Runs on the thread that opened the connection, except at shutdown
+void ConnectionPool::destroyConnection(Connection *connection)
+{
+    QString name = connection->name;
+    clearStatements(connection);
+    connection->db.close();
+    delete connection;
+    QSqlDatabase::removeDatabase(name);
+}
+
+QSqlQuery &ConnectionPool::prepare(Connection *connection, const QString &sql)
+{
+    if (QSqlQuery *query = connection->statements.value(sql)) {
+        m_statementHits.ref();
+        query->finish();
+        return *query;
+    }
+
+    m_statementMisses.ref();
+    auto *query = new QSqlQuery(connection->db);
+    if (query->prepare(sql)) {
+        connection->statements.insert(sql, query);
+        m_preparedStatements.ref();
+    } else {
+        // Keep failures out of the cache, e.g. a prepare issued inside an aborted transaction
+        qWarning() << "Failed to prepare statement:" << query->lastError().text();
+        connection->uncached.append(query);
+    }
+    return *query;
+}
+
+void ConnectionPool::finishStatements(Connection *connection)
+{
+    for (QSqlQuery *query : std::as_const(connection->statements)) {
+        if (query->isActive()) {
+            query->finish();
+        }
+    }
+    qDeleteAll(connection->uncached);
+    connection->uncached.clear();
+}
+
+void ConnectionPool::rollbackAbandoned(Connection *connection)
+{
+    // A borrower that returned early left BEGIN open; the next one must not run inside it
+    if (!connection->inTransaction)
+        return;
+
+    qWarning() << "Rolling back a transaction left open on" << connection->name;
+    finishStatements(connection); // PostgreSQL refuses ROLLBACK while a result set is open
+    if (!connection->db.rollback()) {
+        // The session is in an unknown state; a reopen in validate() will start it afresh
+        qWarning() << "Rollback failed:" << connection->db.lastError().text();
+        connection->db.close();
+    }
+    connection->inTransaction = false;
+}
+
+void ConnectionPool::clearStatements(Connection *connection)
+{
+    m_preparedStatements.fetchAndSubRelaxed(connection->statements.size());
+    qDeleteAll(connection->statements);
+    connection->statements.clear();
+    qDeleteAll(connection->uncached);
+    connection->uncached.clear();
+}
+
+ConnectionPool::Connection *ConnectionPool::takeIdle(QThread *thread)
+{
+    // Called with m_mutex held. Most recently used first, so surplus connections age out and
+    // get trimmed.
+    for (qsizetype i = m_idle.size() - 1; i >= 0; --i) {
+        if (m_idle.at(i)->thread == thread) {
+            return m_idle.takeAt(i);
+        }
+    }
+    return nullptr;
+}
+
+QList<ConnectionPool::Connection *> ConnectionPool::takeExpiredIdle(QThread *thread)
+{
+    // Called with m_mutex held. The front of m_idle holds the least recently used connections.
+    // Returns the expired ones of thread to close; those of other threads are retired.
+    QList<Connection *> expired;
+    while (m_totalCount > m_options.minConnections && m_idle.size() > 1
+           && m_idle.first()->lastUsed.hasExpired(m_options.idleTimeoutMs)) {
+        Connection *connection = m_idle.takeFirst();
+        --m_totalCount;
+        if (connection->thread == thread) {
+            expired.append(connection);
+        } else {
+            m_retired.append(connection);
+        }
+    }
+    return expired;
+}
+
+QList<ConnectionPool::Connection *> ConnectionPool::takeRetired(QThread *thread)
+{
+    // Called with m_mutex held
+    QList<Connection *> retired;
+    for (qsizetype i = m_retired.size() - 1; i >= 0; --i) {
+        if (m_retired.at(i)->thread == thread) {
+            retired.append(m_retired.takeAt(i));
+        }
+    }
+    return retired;
+}
+
+PooledConnection::PooledConnection(ConnectionPool *pool,
+                                   ConnectionPool::Connection *connection,
+                                   bool owned)
+    : m_pool(pool)
+    , m_connection(connection)
+    , m_owned(owned)
+{}
+
+PooledConnection::PooledConnection(PooledConnection &&other) noexcept
+    : m_pool(other.m_pool)
+    , m_connection(other.m_connection)
+    , m_owned(other.m_owned)
+    , m_beganTransaction(other.m_beganTransaction)
+{
+    other.m_pool = nullptr;
+    other.m_connection = nullptr;
+    other.m_beganTransaction = false;
+}
+
+PooledConnection &PooledConnection::operator=(PooledConnection &&other) noexcept
+{
+    if (this != &other) {
+        release();
+        m_pool = other.m_pool;
+        m_connection = other.m_connection;
+        m_owned = other.m_owned;
+        m_beganTransaction = other.m_beganTransaction;
+        other.m_pool = nullptr;
+        other.m_connection = nullptr;
+        other.m_beganTransaction = false;
+    }
+    return *this;
+}
+
+PooledConnection::~PooledConnection()
+{
+    release();
+}
+
+QSqlDatabase PooledConnection::database() const
+{
+    return m_connection ? m_connection->db : QSqlDatabase();
+}
+
+QSqlQuery &PooledConnection::prepare(const QString &sql)
+{
+    Q_ASSERT(m_connection);
+    return m_pool->prepare(m_connection, sql);
+}
+
+bool PooledConnection::transaction()
+{
+    Q_ASSERT(m_connection);
+    if (!m_connection->db.transaction())
+        return false;
+    m_connection->inTransaction = true;
+    m_beganTransaction = true;
+    return true;
+}
+
+bool PooledConnection::commit()
+{
+    Q_ASSERT(m_connection);
+    // After a failed COMMIT the flag stays set, so release() makes sure nothing is left open
+    if (!m_connection->db.commit())
+        return false;
+    m_connection->inTransaction = false;
+    m_beganTransaction = false;
+    return true;
+}
+
+bool PooledConnection::rollback()
+{
+    Q_ASSERT(m_connection);
+    bool rolledBack = m_connection->db.rollback();
+    m_connection->inTransaction = false;
+    m_beganTransaction = false;
+    return rolledBack;
+}
+
+void PooledConnection::release()
+{
+    if (m_pool && m_connection && m_owned) {
+        m_pool->release(m_connection);
+    } else if (m_pool && m_connection && m_beganTransaction) {
+        // A handle borrowed from a ConnectionScope: the next call in the scope must not run
+        // inside this handle's transaction either
+        m_pool->rollbackAbandoned(m_connection);
+    }
+    m_pool = nullptr;
+    m_connection = nullptr;
+    m_beganTransaction = false;
+}
+
+ConnectionScope::ConnectionScope(ConnectionPool &pool)
+    : m_connection(pool.acquire())
+{
+    // Only the outermost scope pins; nested ones hold a borrowed handle
+    if (m_connection.m_owned && m_connection.isValid()) {
+        t_pinned.pool = &pool;
+        t_pinned.connection = m_connection.m_connection;
+    }
+}
+
+ConnectionScope::~ConnectionScope()
+{
+    if (m_connection.m_owned && m_connection.isValid()) {
+        t_pinned = PinnedConnection();
+    }
+}
+
+bool ConnectionScope::isValid() const
+{
+    return m_connection.isValid();
+}
@@ -0,0 +1,154 @@
+#ifndef CONNECTIONPOOL_H
+#define CONNECTIONPOOL_H
+
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include <QList>
+#include <QMutex>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+
+struct ConnectionPoolOptions
+{
+    QString host = "localhost";
+    int port = 5432;
+    QString databaseName = "qlms";
+    QString username = "postgres";
+    QString password = "postgres";
+    int minConnections = 2;
+    int maxConnections = 16;
+    int acquireTimeoutMs = 5000;      // How long acquire() may block waiting for a free connection
+    int validationIntervalMs = 30000; // Idle time after which a connection is pinged on checkout
+    int idleTimeoutMs = 300000;       // Idle time after which surplus connections are closed
+};
+
+class PooledConnection;
+
+// Bounded pool of QPSQL connections shared by all client threads. A QSqlDatabase may only be
+// used on the thread that opened it, so each connection is opened by the thread that first
+// borrows it and is only handed out to that thread again. A thread that finds no idle connection
+// of its own while the pool is full retires the least recently used idle one of another thread,
+// which its owner closes on its next checkout or release. Until then the pool may hold a few
+// more than maxConnections open.
+class ConnectionPool
+{
+public:
+    struct Connection;
+
+    ConnectionPool();
+    ~ConnectionPool();
+
+    bool initialize(const ConnectionPoolOptions &options);
+    void shutdown();
+
+    // Blocks for at most acquireTimeoutMs; returns an invalid handle on timeout or error. The
+    // handle must be used and released on the calling thread. Inside a ConnectionScope on the
+    // calling thread, returns the scope's connection instead.
+    PooledConnection acquire();
+
+    QJsonObject statistics() const;
+
+private:
+    friend class PooledConnection;
+    friend class ConnectionScope;
+
+    ConnectionPool(const ConnectionPool &) = delete;
+    ConnectionPool &operator=(const ConnectionPool &) = delete;
+
+    Connection *openConnection();
+    bool validate(Connection *connection);
+    void release(Connection *connection);
+    void discard(Connection *connection);
+    void destroyConnection(Connection *connection);
+    QSqlQuery &prepare(Connection *connection, const QString &sql);
+    void finishStatements(Connection *connection);
+    void rollbackAbandoned(Connection *connection);
+    void clearStatements(Connection *connection);
+    Connection *takeIdle(QThread *thread);
+    QList<Connection *> takeExpiredIdle(QThread *thread);
+    QList<Connection *> takeRetired(QThread *thread);
+
+    ConnectionPoolOptions m_options;
+    mutable QMutex m_mutex;
+    QWaitCondition m_connectionReleased;
+    QList<Connection *> m_idle;
+    QList<Connection *> m_retired; // No longer counted; left for their owner threads to close
+    int m_totalCount = 0;
+    int m_inUseCount = 0;
+    int m_waitingCount = 0;
+    quint64 m_nextConnectionId = 0;
+    quint64 m_checkouts = 0;
+    quint64 m_waits = 0;
+    quint64 m_timeouts = 0;
+    quint64 m_validationFailures = 0;
+    quint64 m_evictions = 0; // Idle connections retired to make room for another thread
+    bool m_shuttingDown = false;
+
+    // Updated by borrowers without holding m_mutex
+    QAtomicInteger<quint64> m_statementHits = 0;
+    QAtomicInteger<quint64> m_statementMisses = 0;
+    QAtomicInt m_preparedStatements = 0;
+};
+
+// RAII checkout of a pooled connection; returns it to the pool when destroyed.
+// Queries created on database() must be destroyed before the handle is released.
+class PooledConnection
+{
+public:
+    PooledConnection() = default;
+    PooledConnection(PooledConnection &&other) noexcept;
+    PooledConnection &operator=(PooledConnection &&other) noexcept;
+    ~PooledConnection();
+
+    bool isValid() const { return m_connection != nullptr; }
+    QSqlDatabase database() const;
+    void release();
+
+    // Returns a statement prepared once per physical connection and reused by later borrowers.
+    // Only pass static SQL text: every distinct string gets its own server-side statement.
+    // The same text must not be prepared again while its previous result is still being read.
+    QSqlQuery &prepare(const QString &sql);
+
+    // Transaction control; use these rather than database().transaction() so the pool knows
+    // about the transaction. One left open when the handle is released is rolled back.
+    bool transaction();
+    bool commit();
+    bool rollback();
+
+private:
+    friend class ConnectionPool;
+    friend class ConnectionScope;
+
+    PooledConnection(ConnectionPool *pool, ConnectionPool::Connection *connection, bool owned);
+    PooledConnection(const PooledConnection &) = delete;
+    PooledConnection &operator=(const PooledConnection &) = delete;
+
+    ConnectionPool *m_pool = nullptr;
+    ConnectionPool::Connection *m_connection = nullptr;
+    bool m_owned = true; // False for handles borrowed from a ConnectionScope
+    bool m_beganTransaction = false;
+};
+
+// Keeps one connection checked out for the current thread while it exists, so a sequence of
+// database calls (e.g. the commands of a batch) shares it instead of checking out one each.
+// Scopes nest; an inner scope on the same thread just reuses the outer one's connection.
+class ConnectionScope
+{
+public:
+    explicit ConnectionScope(ConnectionPool &pool);
+    ~ConnectionScope();
+
+    bool isValid() const;
+
+private:
+    ConnectionScope(const ConnectionScope &) = delete;
+    ConnectionScope &operator=(const ConnectionScope &) = delete;
+
+    PooledConnection m_connection;
+};
+
+#endif // CONNECTIONPOOL_H
@@ -3,11 +3,13 @@
 #include "question.h"
 #include "user.h"
 #include <QDebug>
+#include <QHash>
 #include <QJsonArray>
+#include <QJsonDocument>
 #include <QJsonObject>
 #include <QSqlError>
 #include <QSqlQuery>
-#include <QThread>
+#include <QStringList>
 
 DatabaseManager &DatabaseManager::instance()
 {
@@ -15,71 +17,61 @@ DatabaseManager &DatabaseManager::instance()
     return instance;
 }
 
-DatabaseManager::DatabaseManager()
-    : m_connectionPrefix("QLMSConnection")
-{}
+DatabaseManager::DatabaseManager() {}
 
 DatabaseManager::~DatabaseManager()
 {
-    QStringList connections = QSqlDatabase::connectionNames();
-    for (const QString &conn : connections) {
-        if (conn.startsWith(m_connectionPrefix)) {
-            QSqlDatabase::removeDatabase(conn);
-        }
-    }
+    m_scheduler.waitForDone();
+    m_pool.shutdown();
 }
 
-bool DatabaseManager::initialize(const QString &host,
-                                 int port,
-                                 const QString &databaseName,
-                                 const QString &username,
-                                 const QString &password)
+bool DatabaseManager::initialize(const ConnectionPoolOptions &options)
 {
-    m_host = host;
-    m_port = port;
-    m_databaseName = databaseName;
-    m_username = username;
-    m_password = password;
-
-    QSqlDatabase db = getDatabase();
-    if (!db.open()) {
-        qCritical() << "Failed to open database:" << db.lastError().text();
+    if (!m_pool.initialize(options)) {
+        qCritical() << "Failed to open database connection pool";
         return false;
     }
 
+    // One executor thread per connection; more would only queue up inside acquire().
+    // Each thread opens its connection on first use and keeps it.
+    m_scheduler.configure(options.maxConnections,
+                          DefaultCriticalReserve,
+                          options.maxConnections / 4);
+
     qInfo() << "Database initialized successfully";
     return true;
 }
 
-QSqlDatabase DatabaseManager::getDatabase()
+QJsonObject DatabaseManager::statistics() const
 {
-    QString connectionName = QString("%1_%2")
-                                 .arg(m_connectionPrefix)
-                                 .arg(reinterpret_cast<quintptr>(QThread::currentThread()));
+    QJsonObject stats;
+    stats["connection_pool"] = m_pool.statistics();
+    stats["scheduler"] = m_scheduler.statistics();
+    stats["quiz_cache"] = m_quizCache.statistics();
+    stats["versions"] = m_versions.statistics();
+    return stats;
+}
 
-    if (!QSqlDatabase::contains(connectionName)) {
-        QSqlDatabase db = QSqlDatabase::addDatabase("QPSQL", connectionName);
-        db.setHostName(m_host);
-        db.setPort(m_port);
-        db.setDatabaseName(m_databaseName);
-        db.setUserName(m_username);
-        db.setPassword(m_password);
-    }
+void DatabaseManager::setSchedulerLimits(int criticalReserve, int bulkConnections)
+{
+    m_scheduler.configure(m_scheduler.threadCount(), criticalReserve, bulkConnections);
+}
 
-    return QSqlDatabase::database(connectionName);
+ConnectionScope DatabaseManager::connectionScope()
+{
+    return ConnectionScope(m_pool);
 }
 
 std::shared_ptr<User> DatabaseManager::authenticateUser(const QString &username,
                                                         const QString &passwordHash)
 {
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return nullptr;
 
-    QSqlQuery query(db);
-    query.prepare("SELECT user_id, username, password_hash, role FROM users "
-                  "WHERE username = :username AND password_hash = :password");
+    QSqlQuery &query = connection.prepare(
+        "SELECT user_id, username, password_hash, role FROM users "
+        "WHERE username = :username AND password_hash = :password");
     query.bindValue(":username", username);
     query.bindValue(":password", passwordHash);
 
@@ -92,13 +84,12 @@ std::shared_ptr<User> DatabaseManager::authenticateUser(const QString &username,
 
 std::shared_ptr<User> DatabaseManager::getUserById(int userId)
 {
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return nullptr;
 
-    QSqlQuery query(db);
-    query.prepare("SELECT user_id, username, password_hash, role FROM users WHERE user_id = :id");
+    QSqlQuery &query = connection.prepare(
+        "SELECT user_id, username, password_hash, role FROM users WHERE user_id = :id");
     query.bindValue(":id", userId);
 
     if (!query.exec() || !query.next()) {
@@ -134,14 +125,12 @@ bool DatabaseManager::createUser(const QString &username,
                                  const QString &passwordHash,
                                  const QString &role)
 {
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return false;
 
-    QSqlQuery query(db);
-    query.prepare("INSERT INTO users (username, password_hash, role) "
-                  "VALUES (:username, :password, :role)");
+    QSqlQuery &query = connection.prepare("INSERT INTO users (username, password_hash, role) "
+                                          "VALUES (:username, :password, :role)");
     query.bindValue(":username", username);
     query.bindValue(":password", passwordHash);
     query.bindValue(":role", role);
@@ -151,34 +140,53 @@ bool DatabaseManager::createUser(const QString &username,
 
 bool DatabaseManager::deleteUser(int userId)
 {
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return false;
 
-    QSqlQuery query(db);
-    query.prepare("DELETE FROM users WHERE user_id = :id");
+    QSqlQuery &query = connection.prepare("DELETE FROM users WHERE user_id = :id");
     query.bindValue(":id", userId);
 
-    return query.exec();
+    if (!query.exec()) {
+        return false;
+    }
+
+    // Materials created by the user lose their creator_id
+    m_quizCache.clear();
+    m_versions.bumpAll();
+    return true;
 }
 
-QList<std::shared_ptr<User>> DatabaseManager::getAllUsers()
+QList<std::shared_ptr<User>> DatabaseManager::getAllUsers(const PageRequest &page,
+                                                         QString *nextCursor,
+                                                         const QString &search)
 {
     QList<std::shared_ptr<User>> users;
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return users;
 
-    QSqlQuery query(db);
-    query.prepare("SELECT user_id, username, password_hash, role FROM users ORDER BY user_id");
+    // Keyset: user_id; ids start at 1, so the first page continues after 0
+    QSqlQuery &query = connection.prepare(
+        "SELECT user_id, username, password_hash, role FROM users "
+        "WHERE user_id > :after_id AND username ILIKE :pattern ESCAPE '\\' "
+        "ORDER BY user_id LIMIT :limit");
+    query.bindValue(":after_id", page.after.isEmpty() ? 0 : page.after[0].toInt());
+    // The search is matched literally, so its own wildcards are escaped
+    QString pattern = search;
+    pattern.replace("\\", "\\\\").replace("%", "\\%").replace("_", "\\_");
+    query.bindValue(":pattern", "%" + pattern + "%");
+    query.bindValue(":limit", page.limit + 1);
 
     if (!query.exec()) {
         return users;
     }
 
     while (query.next()) {
+        if (users.size() == page.limit) {
+            *nextCursor = PageRequest::encodeCursor({users.last()->getId()});
+            break;
+        }
         auto user = createUserFromQuery(query);
         if (user) {
             users.append(user);
@@ -191,13 +199,12 @@ QList<std::shared_ptr<User>> DatabaseManager::getAllUsers()
 QJsonArray DatabaseManager::getAllClasses()
 {
     QJsonArray classes;
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return classes;
 
-    QSqlQuery query(db);
-    query.prepare("SELECT class_id, class_name FROM classes ORDER BY class_name");
+    QSqlQuery &query = connection.prepare(
+        "SELECT class_id, class_name FROM classes ORDER BY class_name");
 
     if (!query.exec()) {
         return classes;
@@ -216,15 +223,13 @@ QJsonArray DatabaseManager::getAllClasses()
 QJsonArray DatabaseManager::getClassesForUser(int userId)
 {
     QJsonArray classes;
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return classes;
 
-    QSqlQuery query(db);
-    query.prepare("SELECT c.class_id, c.class_name FROM classes c "
-                  "JOIN class_members cm ON c.class_id = cm.class_id "
-                  "WHERE cm.user_id = :user_id ORDER BY c.class_name");
+    QSqlQuery &query = connection.prepare("SELECT c.class_id, c.class_name FROM classes c "
+                                          "JOIN class_members cm ON c.class_id = cm.class_id "
+                                          "WHERE cm.user_id = :user_id ORDER BY c.class_name");
     query.bindValue(":user_id", userId);
 
     if (!query.exec()) {
@@ -244,85 +249,116 @@ QJsonArray DatabaseManager::getClassesForUser(int userId)
 
 bool DatabaseManager::createClass(const QString &className)
 {
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return false;
 
-    QSqlQuery query(db);
-    query.prepare("INSERT INTO classes (class_name) VALUES (:class_name)");
+    QSqlQuery &query = connection.prepare("INSERT INTO classes (class_name) VALUES (:class_name)");
     query.bindValue(":class_name", className);
 
     if (!query.exec()) {
         qWarning() << "Failed to create class:" << query.lastError().text();
         return false;
     }
+    m_versions.bump("classes");
+    m_versions.bump("tree");
     return true;
 }
 
 bool DatabaseManager::deleteClass(int classId)
 {
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return false;
 
-    QSqlQuery query(db);
-    query.prepare("DELETE FROM classes WHERE class_id = :class_id");
+    QSqlQuery &query = connection.prepare("DELETE FROM classes WHERE class_id = :class_id");
     query.bindValue(":class_id", classId);
 
-    return query.exec();
+    if (!query.exec()) {
+        return false;
+    }
+
+    // Deleting the class deletes its courses, which detaches their materials
+    m_quizCache.clear();
+    m_versions.bumpAll();
+    return true;
 }
 
 bool DatabaseManager::assignUserToClass(int userId, int classId)
 {
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return false;
 
-    QSqlQuery query(db);
-    query.prepare("INSERT INTO class_members (user_id, class_id) VALUES (:user_id, :class_id)");
+    QSqlQuery &query = connection.prepare(
+        "INSERT INTO class_members (user_id, class_id) VALUES (:user_id, :class_id)");
     query.bindValue(":user_id", userId);
     query.bindValue(":class_id", classId);
 
-    return query.exec();
+    if (!query.exec()) {
+        return false;
+    }
+    // Students only see the classes they belong to
+    m_versions.bump("classes");
+    m_versions.bump("tree");
+    return true;
 }
 
 bool DatabaseManager::removeUserFromClass(int userId, int classId)
 {
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return false;
 
-    QSqlQuery query(db);
-    query.prepare("DELETE FROM class_members WHERE user_id = :user_id AND class_id = :class_id");
+    QSqlQuery &query = connection.prepare(
+        "DELETE FROM class_members WHERE user_id = :user_id AND class_id = :class_id");
     query.bindValue(":user_id", userId);
     query.bindValue(":class_id", classId);
 
-    return query.exec();
+    if (!query.exec()) {
+        return false;
+    }
+    // Students only see the classes they belong to
+    m_versions.bump("classes");
+    m_versions.bump("tree");
+    return true;
 }
 
-QJsonArray DatabaseManager::getClassMembers(int classId)
+QJsonArray DatabaseManager::getClassMembers(int classId,
+                                            const PageRequest &page,
+                                            QString *nextCursor)
 {
     QJsonArray members;
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return members;
 
-    QSqlQuery query(db);
-    query.prepare("SELECT u.user_id, u.username, u.role FROM users u "
-                  "JOIN class_members cm ON u.user_id = cm.user_id "
-                  "WHERE cm.class_id = :class_id");
+    // Keyset: username, which is unique
+    bool firstPage = page.after.isEmpty();
+    QSqlQuery &query = connection.prepare(
+        firstPage ? "SELECT u.user_id, u.username, u.role FROM users u "
+                    "JOIN class_members cm ON u.user_id = cm.user_id "
+                    "WHERE cm.class_id = :class_id "
+                    "ORDER BY u.username LIMIT :limit"
+                  : "SELECT u.user_id, u.username, u.role FROM users u "
+                    "JOIN class_members cm ON u.user_id = cm.user_id "
+                    "WHERE cm.class_id = :class_id AND u.username > :after_username "
+                    "ORDER BY u.username LIMIT :limit");
     query.bindValue(":class_id", classId);
+    if (!firstPage) {
+        query.bindValue(":after_username", page.after[0].toString());
+    }
+    query.bindValue(":limit", page.limit + 1);
 
     if (!query.exec()) {
         return members;
     }
 
     while (query.next()) {
+        if (members.size() == page.limit) {
+            *nextCursor = PageRequest::encodeCursor({members.last()["username"]});
+            break;
+        }
         QJsonObject member;
         member["user_id"] = query.value("user_id").toInt();
         member["username"] = query.value("username").toString();
@@ -333,17 +369,131 @@ QJsonArray DatabaseManager::getClassMembers(int classId)
     return members;
 }
 
+QJsonArray DatabaseManager::getClassTree(int userId, int depth, bool withContent)
+{
+    QJsonArray tree;
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
+        return tree;
+
+    // Each level is one statement; non-admins are limited to the classes they belong to
+    bool allClasses = userId < 0;
+
+    QSqlQuery &classesQuery = connection.prepare(
+        allClasses ? "SELECT class_id, class_name FROM classes ORDER BY class_name"
+                   : "SELECT c.class_id, c.class_name FROM classes c "
+                     "JOIN class_members m ON c.class_id = m.class_id "
+                     "WHERE m.user_id = :user_id ORDER BY c.class_name");
+    if (!allClasses) {
+        classesQuery.bindValue(":user_id", userId);
+    }
+    if (!classesQuery.exec()) {
+        qWarning() << "Failed to load class tree:" << classesQuery.lastError().text();
+        return tree;
+    }
+
+    QList<QJsonObject> classes;
+    while (classesQuery.next()) {
+        QJsonObject classObj;
+        classObj["class_id"] = classesQuery.value("class_id").toInt();
+        classObj["class_name"] = classesQuery.value("class_name").toString();
+        classes.append(classObj);
+    }
+
+    QHash<int, QJsonArray> materialsByCourse;
+    if (depth >= 3) {
+        QString sql = "SELECT cm.material_id, cm.title, cm.type, cm.course_id, "
+                      "u.username AS instructor_name";
+        if (withContent) {
+            sql += ", tl.content, q.max_attempts, q.feedback_type";
+        }
+        sql += " FROM course_materials cm "
+               "JOIN courses co ON cm.course_id = co.course_id ";
+        if (!allClasses) {
+            sql += "JOIN class_members m ON co.class_id = m.class_id AND m.user_id = :user_id ";
+        }
+        sql += "LEFT JOIN users u ON cm.creator_id = u.user_id ";
+        if (withContent) {
+            sql += "LEFT JOIN text_lessons tl ON cm.material_id = tl.lesson_id "
+                   "LEFT JOIN quizzes q ON cm.material_id = q.quiz_id ";
+        }
+        sql += "ORDER BY cm.title";
+
+        QSqlQuery &materialsQuery = connection.prepare(sql);
+        if (!allClasses) {
+            materialsQuery.bindValue(":user_id", userId);
+        }
+        if (!materialsQuery.exec()) {
+            qWarning() << "Failed to load class tree materials:"
+                       << materialsQuery.lastError().text();
+            return tree;
+        }
+
+        while (materialsQuery.next()) {
+            QJsonObject material;
+            material["material_id"] = materialsQuery.value("material_id").toInt();
+            material["title"] = materialsQuery.value("title").toString();
+            material["type"] = materialsQuery.value("type").toString();
+            material["instructor_name"] = materialsQuery.value("instructor_name").toString();
+            if (withContent) {
+                if (material["type"].toString() == "lesson") {
+                    material["content"] = materialsQuery.value("content").toString();
+                } else {
+                    material["max_attempts"] = materialsQuery.value("max_attempts").toInt();
+                    material["feedback_type"] = materialsQuery.value("feedback_type").toString();
+                }
+            }
+            materialsByCourse[materialsQuery.value("course_id").toInt()].append(material);
+        }
+    }
+
+    QHash<int, QJsonArray> coursesByClass;
+    if (depth >= 2) {
+        QSqlQuery &coursesQuery = connection.prepare(
+            allClasses ? "SELECT course_id, course_name, class_id FROM courses ORDER BY course_name"
+                       : "SELECT co.course_id, co.course_name, co.class_id FROM courses co "
+                         "JOIN class_members m ON co.class_id = m.class_id "
+                         "WHERE m.user_id = :user_id ORDER BY co.course_name");
+        if (!allClasses) {
+            coursesQuery.bindValue(":user_id", userId);
+        }
+        if (!coursesQuery.exec()) {
+            qWarning() << "Failed to load class tree courses:" << coursesQuery.lastError().text();
+            return tree;
+        }
+
+        while (coursesQuery.next()) {
+            int courseId = coursesQuery.value("course_id").toInt();
+            QJsonObject course;
+            course["course_id"] = courseId;
+            course["course_name"] = coursesQuery.value("course_name").toString();
+            if (depth >= 3) {
+                course["materials"] = materialsByCourse.take(courseId);
+            }
+            coursesByClass[coursesQuery.value("class_id").toInt()].append(course);
+        }
+    }
+
+    for (QJsonObject &classObj : classes) {
+        if (depth >= 2) {
+            classObj["courses"] = coursesByClass.take(classObj["class_id"].toInt());
+        }
+        tree.append(classObj);
+    }
+
+    return tree;
+}
+
 QJsonArray DatabaseManager::getCoursesForClass(int classId)
 {
     QJsonArray courses;
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return courses;
 
-    QSqlQuery query(db);
-    query.prepare("SELECT course_id, course_name FROM courses WHERE class_id = :class_id ORDER BY "
-                  "course_name");
+    QSqlQuery &query = connection.prepare(
+        "SELECT course_id, course_name FROM courses WHERE class_id = :class_id ORDER BY "
+        "course_name");
     query.bindValue(":class_id", classId);
 
     if (!query.exec()) {
@@ -360,15 +510,33 @@ QJsonArray DatabaseManager::getCoursesForClass(int classId)
     return courses;
 }
 
+bool DatabaseManager::isCourseMember(int userId, int courseId)
+{
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
+        return false;
+
+    QSqlQuery &query = connection.prepare(
+        "SELECT 1 FROM courses co JOIN class_members m ON co.class_id = m.class_id "
+        "WHERE co.course_id = :course_id AND m.user_id = :user_id");
+    query.bindValue(":course_id", courseId);
+    query.bindValue(":user_id", userId);
+
+    if (!query.exec()) {
+        qWarning() << "Failed to check course membership:" << query.lastError().text();
+        return false;
+    }
+    return query.next();
+}
+
 bool DatabaseManager::createCourse(const QString &courseName, int classId)
 {
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return false;
 
-    QSqlQuery query(db);
-    query.prepare("INSERT INTO courses (course_name, class_id) VALUES (:course_name, :class_id)");
+    QSqlQuery &query = connection.prepare(
+        "INSERT INTO courses (course_name, class_id) VALUES (:course_name, :class_id)");
     query.bindValue(":course_name", courseName);
     query.bindValue(":class_id", classId);
 
@@ -376,41 +544,47 @@ bool DatabaseManager::createCourse(const QString &courseName, int classId)
         qWarning() << "Failed to create course:" << query.lastError().text();
         return false;
     }
+    m_versions.bump(QString("class:%1").arg(classId));
+    m_versions.bump("tree");
     return true;
 }
 
 bool DatabaseManager::deleteCourse(int courseId)
 {
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return false;
 
-    QSqlQuery query(db);
-    query.prepare("DELETE FROM courses WHERE course_id = :course_id");
+    QSqlQuery &query = connection.prepare("DELETE FROM courses WHERE course_id = :course_id");
     query.bindValue(":course_id", courseId);
 
-    return query.exec();
+    if (!query.exec()) {
+        return false;
+    }
+
+    // The course's materials are kept with a NULL course_id
+    m_quizCache.clear();
+    m_versions.bumpAll();
+    return true;
 }
 
-QList<std::shared_ptr<CourseMaterial>> DatabaseManager::getAllMaterials()
+QList<std::shared_ptr<const CourseMaterial>> DatabaseManager::getAllMaterials()
 {
-    QList<std::shared_ptr<CourseMaterial>> materials;
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    QList<std::shared_ptr<const CourseMaterial>> materials;
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return materials;
 
-    QSqlQuery query(db);
-    query.prepare("SELECT material_id, title, type, course_id, creator_id FROM course_materials "
-                  "ORDER BY material_id");
+    QSqlQuery &query = connection.prepare(
+        "SELECT material_id, title, type, course_id, creator_id FROM course_materials "
+        "ORDER BY material_id");
 
     if (!query.exec()) {
         return materials;
     }
 
     while (query.next()) {
-        auto material = createMaterialFromQuery(query, db);
+        auto material = createMaterialFromQuery(query, connection);
         if (material) {
             materials.append(material);
         }
@@ -419,41 +593,81 @@ QList<std::shared_ptr<CourseMaterial>> DatabaseManager::getAllMaterials()
     return materials;
 }
 
-std::shared_ptr<CourseMaterial> DatabaseManager::getMaterialById(int materialId)
+std::shared_ptr<const CourseMaterial> DatabaseManager::getMaterialById(int materialId)
 {
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return nullptr;
 
-    QSqlQuery query(db);
-    query.prepare("SELECT material_id, title, type, course_id, creator_id FROM course_materials "
-                  "WHERE material_id = :id");
+    QSqlQuery &query = connection.prepare(
+        "SELECT material_id, title, type, course_id, creator_id FROM course_materials "
+        "WHERE material_id = :id");
     query.bindValue(":id", materialId);
 
     if (!query.exec() || !query.next()) {
         return nullptr;
     }
 
-    return createMaterialFromQuery(query, db);
+    return createMaterialFromQuery(query, connection);
 }
 
 bool DatabaseManager::deleteMaterial(int materialId)
 {
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return false;
 
-    QSqlQuery query(db);
-    query.prepare("DELETE FROM course_materials WHERE material_id = :id");
+    QSqlQuery &query = connection.prepare(
+        "DELETE FROM course_materials WHERE material_id = :id RETURNING course_id");
     query.bindValue(":id", materialId);
 
-    return query.exec();
+    if (!query.exec()) {
+        return false;
+    }
+
+    m_quizCache.remove(materialId);
+    m_versions.bumpAll();
+    if (query.next()) {
+        int courseId = query.value(0).toInt();
+        query.finish();
+        notify(connection,
+               QString("course:%1").arg(courseId),
+               {{"event", "material_deleted"}, {"material_id", materialId}});
+    }
+    return true;
+}
+
+QJsonObject DatabaseManager::getLessonChunk(int lessonId, qint64 offset, int length)
+{
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
+        return QJsonObject();
+
+    // substring() counts characters from 1. Probing the character after the chunk tells whether
+    // more follow without measuring the whole text.
+    QSqlQuery &query = connection.prepare(
+        "SELECT substring(content FROM :start FOR :length) AS chunk, "
+        "char_length(substring(content FROM :next_start FOR 1)) > 0 AS has_more "
+        "FROM text_lessons WHERE lesson_id = :id");
+    query.bindValue(":start", offset + 1);
+    query.bindValue(":length", length);
+    query.bindValue(":next_start", offset + length + 1);
+    query.bindValue(":id", lessonId);
+
+    if (!query.exec() || !query.next()) {
+        return QJsonObject();
+    }
+
+    QJsonObject chunk;
+    chunk["material_id"] = lessonId;
+    chunk["offset"] = offset;
+    chunk["content"] = query.value("chunk").toString();
+    chunk["done"] = !query.value("has_more").toBool();
+    return chunk;
 }
 
-std::shared_ptr<CourseMaterial> DatabaseManager::createMaterialFromQuery(const QSqlQuery &query,
-                                                                         QSqlDatabase &db)
+std::shared_ptr<const CourseMaterial> DatabaseManager::createMaterialFromQuery(
+    const QSqlQuery &query, PooledConnection &connection)
 {
     int id = query.value("material_id").toInt();
     QString title = query.value("title").toString();
@@ -465,8 +679,8 @@ std::shared_ptr<CourseMaterial> DatabaseManager::createMaterialFromQuery(const Q
         auto lesson = std::make_shared<TextLesson>(id, title, courseId, creatorId);
 
         // Load lesson content
-        QSqlQuery contentQuery(db);
-        contentQuery.prepare("SELECT content FROM text_lessons WHERE lesson_id = :id");
+        QSqlQuery &contentQuery = connection.prepare(
+            "SELECT content FROM text_lessons WHERE lesson_id = :id");
         contentQuery.bindValue(":id", id);
         if (contentQuery.exec() && contentQuery.next()) {
             lesson->setContent(contentQuery.value("content").toString());
@@ -474,46 +688,85 @@ std::shared_ptr<CourseMaterial> DatabaseManager::createMaterialFromQuery(const Q
 
         return lesson;
     } else if (type == "quiz") {
-        auto quiz = loadQuizDetails(id);
-        if (quiz) {
-            quiz->setCourseId(courseId);
-            quiz->setCreatorId(creatorId);
-        }
-        return quiz;
+        return cachedQuiz(id, connection);
     }
 
     return nullptr;
 }
 
-std::shared_ptr<Quiz> DatabaseManager::loadQuizDetails(int quizId)
+std::shared_ptr<const Quiz> DatabaseManager::getQuiz(int quizId)
 {
-    QSqlDatabase db = getDatabase();
+    return m_quizCache.getOrLoad(quizId, [this, quizId]() -> std::shared_ptr<const Quiz> {
+        PooledConnection connection = m_pool.acquire();
+        if (!connection.isValid())
+            return nullptr;
+        return loadQuizDetails(quizId, connection);
+    });
+}
+
+void DatabaseManager::setQuizCacheLimits(int maxEntries, qint64 maxBytes)
+{
+    m_quizCache.setLimits(maxEntries, maxBytes);
+}
 
+std::shared_ptr<const Quiz> DatabaseManager::cachedQuiz(int quizId, PooledConnection &connection)
+{
+    return m_quizCache.getOrLoad(quizId, [this, quizId, &connection]() {
+        return loadQuizDetails(quizId, connection);
+    });
+}
+
+std::shared_ptr<const Quiz> DatabaseManager::loadQuizDetails(int quizId,
+                                                             PooledConnection &connection)
+{
     // Get quiz basic info including feedback type
-    QSqlQuery quizQuery(db);
-    quizQuery.prepare("SELECT cm.title, q.max_attempts, q.feedback_type "
-                      "FROM course_materials cm "
-                      "JOIN quizzes q ON cm.material_id = q.quiz_id "
-                      "WHERE q.quiz_id = :id");
+    QSqlQuery &quizQuery = connection.prepare(
+        "SELECT cm.title, cm.course_id, cm.creator_id, q.max_attempts, q.feedback_type "
+        "FROM course_materials cm "
+        "JOIN quizzes q ON cm.material_id = q.quiz_id "
+        "WHERE q.quiz_id = :id");
     quizQuery.bindValue(":id", quizId);
 
     if (!quizQuery.exec() || !quizQuery.next()) {
         return nullptr;
     }
 
-    auto quiz = std::make_shared<Quiz>(quizId, quizQuery.value("title").toString());
+    auto quiz = std::make_shared<Quiz>(quizId,
+                                       quizQuery.value("title").toString(),
+                                       quizQuery.value("course_id").toInt(),
+                                       quizQuery.value("creator_id").toInt());
     quiz->setMaxAttempts(quizQuery.value("max_attempts").toInt());
     quiz->setFeedbackType(quizQuery.value("feedback_type").toString());
 
+    // Load all options for the quiz in one query and group them by question, so hydration costs
+    // the same number of round trips whatever the quiz size
+    QSqlQuery &optionsQuery = connection.prepare(
+        "SELECT o.question_id, o.option_text, o.is_correct "
+        "FROM question_options o "
+        "JOIN questions q ON o.question_id = q.question_id "
+        "WHERE q.quiz_id = :id ORDER BY o.question_id, o.option_id");
+    optionsQuery.bindValue(":id", quizId);
+
+    QHash<int, QList<QPair<QString, bool>>> optionsByQuestion;
+    if (optionsQuery.exec()) {
+        while (optionsQuery.next()) {
+            optionsByQuestion[optionsQuery.value("question_id").toInt()].append(
+                qMakePair(optionsQuery.value("option_text").toString(),
+                          optionsQuery.value("is_correct").toBool()));
+        }
+    }
+
     // Load questions
-    QSqlQuery questionsQuery(db);
-    questionsQuery.prepare("SELECT question_id, quiz_id, prompt, question_type "
-                           "FROM questions WHERE quiz_id = :id ORDER BY question_id");
+    QSqlQuery &questionsQuery = connection.prepare(
+        "SELECT question_id, quiz_id, prompt, question_type "
+        "FROM questions WHERE quiz_id = :id ORDER BY question_id");
     questionsQuery.bindValue(":id", quizId);
 
     if (questionsQuery.exec()) {
         while (questionsQuery.next()) {
-            auto question = createQuestionFromQuery(questionsQuery, db);
+            int questionId = questionsQuery.value("question_id").toInt();
+            auto question = createQuestionFromQuery(questionsQuery,
+                                                    optionsByQuestion.value(questionId));
             if (question) {
                 quiz->addQuestion(question);
             }
@@ -523,49 +776,32 @@ std::shared_ptr<Quiz> DatabaseManager::loadQuizDetails(int quizId)
     return quiz;
 }
 
-std::shared_ptr<Question> DatabaseManager::createQuestionFromQuery(const QSqlQuery &query,
-                                                                   QSqlDatabase &db)
+std::shared_ptr<Question> DatabaseManager::createQuestionFromQuery(
+    const QSqlQuery &query, const QList<QPair<QString, bool>> &options)
 {
     int id = query.value("question_id").toInt();
     int quizId = query.value("quiz_id").toInt();
     QString prompt = query.value("prompt").toString();
     QString type = query.value("question_type").toString();
 
-    std::shared_ptr<Question> question;
-
+    // Options are added while the concrete type is still known
     if (type == "checkbox") {
-        question = std::make_shared<CheckboxQuestion>(id, quizId, prompt);
+        auto question = std::make_shared<CheckboxQuestion>(id, quizId, prompt);
+        for (const auto &option : options) {
+            question->addOption(option.first, option.second);
+        }
+        return question;
     } else if (type == "radio") {
-        question = std::make_shared<RadioButtonQuestion>(id, quizId, prompt);
-    } else if (type == "open_answer") {
-        question = std::make_shared<OpenAnswerQuestion>(id, quizId, prompt);
-    } else {
-        return nullptr;
-    }
-
-    // Load options for checkbox and radio questions
-    if (type == "checkbox" || type == "radio") {
-        QSqlQuery optionsQuery(db);
-        optionsQuery.prepare("SELECT option_text, is_correct FROM question_options "
-                             "WHERE question_id = :id ORDER BY option_id");
-        optionsQuery.bindValue(":id", id);
-
-        if (optionsQuery.exec()) {
-            while (optionsQuery.next()) {
-                QString optionText = optionsQuery.value("option_text").toString();
-                bool isCorrect = optionsQuery.value("is_correct").toBool();
-
-                if (auto cbQuestion = std::dynamic_pointer_cast<CheckboxQuestion>(question)) {
-                    cbQuestion->addOption(optionText, isCorrect);
-                } else if (auto rbQuestion = std::dynamic_pointer_cast<RadioButtonQuestion>(
-                               question)) {
-                    rbQuestion->addOption(optionText, isCorrect);
-                }
-            }
+        auto question = std::make_shared<RadioButtonQuestion>(id, quizId, prompt);
+        for (const auto &option : options) {
+            question->addOption(option.first, option.second);
         }
+        return question;
+    } else if (type == "open_answer") {
+        return std::make_shared<OpenAnswerQuestion>(id, quizId, prompt);
     }
 
-    return question;
+    return nullptr;
 }
 
 bool DatabaseManager::createLesson(const QString &title,
@@ -573,133 +809,163 @@ bool DatabaseManager::createLesson(const QString &title,
                                    int courseId,
                                    int creatorId)
 {
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return false;
 
-    db.transaction();
+    connection.transaction();
 
-    QSqlQuery query(db);
-    query.prepare("INSERT INTO course_materials (title, type, course_id, creator_id) VALUES "
-                  "(:title, 'lesson', :course_id, :creator_id) RETURNING material_id");
+    QSqlQuery &query = connection.prepare(
+        "INSERT INTO course_materials (title, type, course_id, creator_id) VALUES "
+        "(:title, 'lesson', :course_id, :creator_id) RETURNING material_id");
     query.bindValue(":title", title);
     query.bindValue(":course_id", courseId);
     query.bindValue(":creator_id", creatorId);
 
     if (!query.exec() || !query.next()) {
         qWarning() << "Failed to create lesson material entry:" << query.lastError().text();
-        db.rollback();
+        connection.rollback();
         return false;
     }
 
     int materialId = query.value(0).toInt();
 
-    query.prepare("INSERT INTO text_lessons (lesson_id, content) VALUES (:id, :content)");
-    query.bindValue(":id", materialId);
-    query.bindValue(":content", content);
+    QSqlQuery &lessonQuery = connection.prepare(
+        "INSERT INTO text_lessons (lesson_id, content) VALUES (:id, :content)");
+    lessonQuery.bindValue(":id", materialId);
+    lessonQuery.bindValue(":content", content);
 
-    if (!query.exec()) {
-        qWarning() << "Failed to create text_lesson entry:" << query.lastError().text();
-        db.rollback();
+    if (!lessonQuery.exec()) {
+        qWarning() << "Failed to create text_lesson entry:" << lessonQuery.lastError().text();
+        connection.rollback();
+        return false;
+    }
+
+    if (!notify(connection,
+                QString("course:%1").arg(courseId),
+                {{"event", "material_added"}, {"material_id", materialId}})) {
+        connection.rollback();
+        return false;
+    }
+
+    if (!connection.commit()) {
         return false;
     }
 
-    return db.commit();
+    m_versions.bump(QString("course:%1").arg(courseId));
+    m_versions.bump("tree");
+    return true;
 }
 
 bool DatabaseManager::createQuizWithQuestions(const QJsonObject &quizData,
                                               int courseId,
                                               int creatorId)
 {
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return false;
 
-    db.transaction();
+    connection.transaction();
 
     // 1. Create course_material entry
-    QSqlQuery query(db);
-    query.prepare("INSERT INTO course_materials (title, type, course_id, creator_id) VALUES "
-                  "(:title, 'quiz', :course_id, :creator_id) RETURNING material_id");
+    QSqlQuery &query = connection.prepare(
+        "INSERT INTO course_materials (title, type, course_id, creator_id) VALUES "
+        "(:title, 'quiz', :course_id, :creator_id) RETURNING material_id");
     query.bindValue(":title", quizData["title"].toString());
     query.bindValue(":course_id", courseId);
     query.bindValue(":creator_id", creatorId);
 
     if (!query.exec() || !query.next()) {
         qWarning() << "Failed to create quiz material entry:" << query.lastError().text();
-        db.rollback();
+        connection.rollback();
         return false;
     }
     int quizId = query.value(0).toInt();
 
     // 2. Create quizzes entry
-    query.prepare("INSERT INTO quizzes (quiz_id, max_attempts, feedback_type) VALUES (:id, "
-                  ":attempts, :feedback)");
-    query.bindValue(":id", quizId);
-    query.bindValue(":attempts", quizData["max_attempts"].toInt());
-    query.bindValue(":feedback", quizData["feedback_type"].toString());
+    QSqlQuery &quizQuery = connection.prepare(
+        "INSERT INTO quizzes (quiz_id, max_attempts, feedback_type) VALUES (:id, "
+        ":attempts, :feedback)");
+    quizQuery.bindValue(":id", quizId);
+    quizQuery.bindValue(":attempts", quizData["max_attempts"].toInt());
+    quizQuery.bindValue(":feedback", quizData["feedback_type"].toString());
 
-    if (!query.exec()) {
-        qWarning() << "Failed to create quizzes entry:" << query.lastError().text();
-        db.rollback();
+    if (!quizQuery.exec()) {
+        qWarning() << "Failed to create quizzes entry:" << quizQuery.lastError().text();
+        connection.rollback();
         return false;
     }
 
     // 3. Create questions and options
+    QSqlQuery &questionQuery = connection.prepare(
+        "INSERT INTO questions (quiz_id, prompt, question_type) VALUES (:quiz_id, "
+        ":prompt, :type) RETURNING question_id");
+    QSqlQuery &optionQuery = connection.prepare(
+        "INSERT INTO question_options (question_id, option_text, is_correct) "
+        "VALUES (:q_id, :text, :correct)");
+
     QJsonArray questions = quizData["questions"].toArray();
     for (const QJsonValue &qVal : questions) {
         QJsonObject qObj = qVal.toObject();
 
-        query.prepare("INSERT INTO questions (quiz_id, prompt, question_type) VALUES (:quiz_id, "
-                      ":prompt, :type) RETURNING question_id");
-        query.bindValue(":quiz_id", quizId);
-        query.bindValue(":prompt", qObj["prompt"].toString());
-        query.bindValue(":type", qObj["question_type"].toString());
+        questionQuery.bindValue(":quiz_id", quizId);
+        questionQuery.bindValue(":prompt", qObj["prompt"].toString());
+        questionQuery.bindValue(":type", qObj["question_type"].toString());
 
-        if (!query.exec() || !query.next()) {
-            qWarning() << "Failed to create question entry:" << query.lastError().text();
-            db.rollback();
+        if (!questionQuery.exec() || !questionQuery.next()) {
+            qWarning() << "Failed to create question entry:" << questionQuery.lastError().text();
+            connection.rollback();
             return false;
         }
-        int questionId = query.value(0).toInt();
+        int questionId = questionQuery.value(0).toInt();
 
         if (qObj.contains("options")) {
             QJsonArray options = qObj["options"].toArray();
             for (const QJsonValue &oVal : options) {
                 QJsonObject oObj = oVal.toObject();
-                query.prepare("INSERT INTO question_options (question_id, option_text, is_correct) "
-                              "VALUES (:q_id, :text, :correct)");
-                query.bindValue(":q_id", questionId);
-                query.bindValue(":text", oObj["text"].toString());
-                query.bindValue(":correct", oObj["is_correct"].toBool());
-
-                if (!query.exec()) {
-                    qWarning() << "Failed to create option entry:" << query.lastError().text();
-                    db.rollback();
+                optionQuery.bindValue(":q_id", questionId);
+                optionQuery.bindValue(":text", oObj["text"].toString());
+                optionQuery.bindValue(":correct", oObj["is_correct"].toBool());
+
+                if (!optionQuery.exec()) {
+                    qWarning() << "Failed to create option entry:"
+                               << optionQuery.lastError().text();
+                    connection.rollback();
                     return false;
                 }
             }
         }
     }
 
-    return db.commit();
+    if (!notify(connection,
+                QString("course:%1").arg(courseId),
+                {{"event", "material_added"}, {"material_id", quizId}})) {
+        connection.rollback();
+        return false;
+    }
+
+    if (!connection.commit()) {
+        return false;
+    }
+
+    m_quizCache.remove(quizId);
+    m_versions.bump(QString("course:%1").arg(courseId));
+    m_versions.bump("tree");
+    return true;
 }
 
 QJsonArray DatabaseManager::getMaterialsForCourse(int courseId)
 {
     QJsonArray materials;
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return materials;
 
-    QSqlQuery query(db);
-    query.prepare("SELECT cm.material_id, cm.title, cm.type, u.username as instructor_name "
-                  "FROM course_materials cm "
-                  "LEFT JOIN users u ON cm.creator_id = u.user_id "
-                  "WHERE cm.course_id = :course_id ORDER BY cm.title");
+    QSqlQuery &query = connection.prepare(
+        "SELECT cm.material_id, cm.title, cm.type, u.username as instructor_name "
+        "FROM course_materials cm "
+        "LEFT JOIN users u ON cm.creator_id = u.user_id "
+        "WHERE cm.course_id = :course_id ORDER BY cm.title");
     query.bindValue(":course_id", courseId);
 
     if (!query.exec()) {
@@ -718,194 +984,166 @@ QJsonArray DatabaseManager::getMaterialsForCourse(int courseId)
     return materials;
 }
 
-int DatabaseManager::createQuizAttempt(int quizId, int studentId, int attemptNumber)
-{
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
-        return -1;
-
-    QSqlQuery query(db);
-    query.prepare("INSERT INTO quiz_attempts (quiz_id, student_id, attempt_number, status, "
-                  "total_auto_points, total_manual_points) "
-                  "VALUES (:quiz_id, :student_id, :attempt, 'pending_manual_grading', 0, 0) "
-                  "RETURNING attempt_id");
-    query.bindValue(":quiz_id", quizId);
-    query.bindValue(":student_id", studentId);
-    query.bindValue(":attempt", attemptNumber);
-
-    if (!query.exec() || !query.next()) {
-        return -1;
-    }
-
-    return query.value(0).toInt();
-}
-
-bool DatabaseManager::saveAnswer(int attemptId, int questionId, const QString &response)
+QJsonObject DatabaseManager::submitQuizAttempt(int quizId, int studentId, const QJsonArray &answers)
 {
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
-        return false;
-
-    QSqlQuery query(db);
-    query.prepare("INSERT INTO answers (attempt_id, question_id, student_response, max_points) "
-                  "VALUES (:attempt_id, :question_id, :response, 1.0)");
-    query.bindValue(":attempt_id", attemptId);
-    query.bindValue(":question_id", questionId);
-    query.bindValue(":response", response);
-
-    return query.exec();
-}
-
-QJsonObject DatabaseManager::autoGradeQuizAttempt(int attemptId)
-{
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open()) {
-        QJsonObject result;
-        result["success"] = false;
-        return result;
-    }
-
-    db.transaction();
-
-    // Get quiz details and questions
-    QSqlQuery query(db);
-    query.prepare("SELECT qa.quiz_id, q.feedback_type FROM quiz_attempts qa "
-                  "JOIN quizzes q ON qa.quiz_id = q.quiz_id "
-                  "WHERE qa.attempt_id = :attempt_id");
-    query.bindValue(":attempt_id", attemptId);
+    QJsonObject result;
+    result["success"] = false;
 
-    if (!query.exec() || !query.next()) {
-        db.rollback();
-        QJsonObject result;
-        result["success"] = false;
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return result;
-    }
-
-    int quizId = query.value("quiz_id").toInt();
-    QString feedbackType = query.value("feedback_type").toString();
-
-    // Load all questions for this quiz
-    auto quiz = loadQuizDetails(quizId);
+    auto quiz = cachedQuiz(quizId, connection);
     if (!quiz) {
-        db.rollback();
-        QJsonObject result;
-        result["success"] = false;
         return result;
     }
 
-    // Get all answers for this attempt
-    query.prepare(
-        "SELECT question_id, student_response FROM answers WHERE attempt_id = :attempt_id");
-    query.bindValue(":attempt_id", attemptId);
-
-    QMap<int, QString> studentAnswers;
-    if (query.exec()) {
-        while (query.next()) {
-            studentAnswers[query.value("question_id").toInt()] = query.value("student_response")
-                                                                     .toString();
-        }
+    QHash<int, QString> responses;
+    for (const QJsonValue &val : answers) {
+        QJsonObject answer = val.toObject();
+        responses.insert(answer["question_id"].toInt(), answer["response"].toString());
     }
 
-    // Grade each question
+    // Grade in memory against the cached definition; answers to questions outside the quiz are
+    // dropped
+    struct GradedAnswer
+    {
+        int questionId;
+        QString response;
+        QVariant isCorrect;
+        QVariant points;
+    };
+    QList<GradedAnswer> graded;
     float totalAutoPoints = 0;
     float earnedAutoPoints = 0;
     int openAnswerCount = 0;
-    bool hasOpenAnswers = false;
 
     for (const auto &question : quiz->getQuestions()) {
         int questionId = question->getId();
-        QString studentResponse = studentAnswers.value(questionId);
+        bool answered = responses.contains(questionId);
+        QString response = responses.value(questionId);
 
         if (question->getType() == "open_answer") {
-            hasOpenAnswers = true;
             openAnswerCount++;
-
-            // Update answer record for open answer questions
-            query.prepare("UPDATE answers SET is_correct = NULL, points_earned = NULL "
-                          "WHERE attempt_id = :attempt_id AND question_id = :question_id");
-            query.bindValue(":attempt_id", attemptId);
-            query.bindValue(":question_id", questionId);
-            query.exec();
+            if (answered) {
+                graded.append({questionId,
+                               response,
+                               QVariant(QMetaType::fromType<bool>()),
+                               QVariant(QMetaType::fromType<double>())});
+            }
         } else {
-            // Auto-grade multiple choice questions
-            bool isCorrect = question->validateAnswer(studentResponse);
+            bool isCorrect = question->validateAnswer(response);
             float points = isCorrect ? 1.0 : 0.0;
-
             totalAutoPoints += 1.0;
             earnedAutoPoints += points;
-
-            // Update answer record with grading info
-            query.prepare("UPDATE answers SET is_correct = :correct, points_earned = :points "
-                          "WHERE attempt_id = :attempt_id AND question_id = :question_id");
-            query.bindValue(":correct", isCorrect);
-            query.bindValue(":points", points);
-            query.bindValue(":attempt_id", attemptId);
-            query.bindValue(":question_id", questionId);
-            query.exec();
+            if (answered) {
+                graded.append({questionId, response, isCorrect, static_cast<double>(points)});
+            }
         }
     }
 
-    // Calculate auto score percentage
+    bool hasOpenAnswers = openAnswerCount > 0;
     float autoScore = totalAutoPoints > 0 ? (earnedAutoPoints / totalAutoPoints) * 100.0 : 0;
-
-    // Update quiz attempt with scores
     QString status = hasOpenAnswers ? "pending_manual_grading" : "completed";
 
-    if (hasOpenAnswers) {
-        query.prepare("UPDATE quiz_attempts SET status = :status, auto_score = :auto_score, "
-                      "total_auto_points = :total_auto, total_manual_points = :total_manual "
-                      "WHERE attempt_id = :attempt_id");
-        query.bindValue(":status", status);
-        query.bindValue(":auto_score", autoScore);
-        query.bindValue(":total_auto", static_cast<int>(totalAutoPoints));
-        query.bindValue(":total_manual", openAnswerCount);
-        query.bindValue(":attempt_id", attemptId);
-    } else {
-        // No open answers, so final score equals auto score
-        query.prepare("UPDATE quiz_attempts SET status = :status, auto_score = :auto_score, "
-                      "final_score = :final_score, total_auto_points = :total_auto, "
-                      "total_manual_points = 0, graded_at = CURRENT_TIMESTAMP "
-                      "WHERE attempt_id = :attempt_id");
-        query.bindValue(":status", status);
-        query.bindValue(":auto_score", autoScore);
-        query.bindValue(":final_score", autoScore);
-        query.bindValue(":total_auto", static_cast<int>(totalAutoPoints));
-        query.bindValue(":attempt_id", attemptId);
+    connection.transaction();
+
+    // The attempt number is derived in the same statement; UNIQUE(quiz_id, student_id,
+    // attempt_number) rejects a concurrent duplicate submission
+    QSqlQuery &attemptQuery = connection.prepare(
+        hasOpenAnswers
+            ? "INSERT INTO quiz_attempts (quiz_id, student_id, attempt_number, status, auto_score, "
+              "total_auto_points, total_manual_points) "
+              "SELECT :quiz_id, :student_id, COALESCE(MAX(attempt_number), 0) + 1, "
+              "'pending_manual_grading', :auto_score, :total_auto, :total_manual "
+              "FROM quiz_attempts WHERE quiz_id = :quiz_id AND student_id = :student_id "
+              "RETURNING attempt_id"
+            : "INSERT INTO quiz_attempts (quiz_id, student_id, attempt_number, status, auto_score, "
+              "final_score, total_auto_points, total_manual_points, graded_at) "
+              "SELECT :quiz_id, :student_id, COALESCE(MAX(attempt_number), 0) + 1, "
+              "'completed', :auto_score, :auto_score, :total_auto, :total_manual, "
+              "CURRENT_TIMESTAMP "
+              "FROM quiz_attempts WHERE quiz_id = :quiz_id AND student_id = :student_id "
+              "RETURNING attempt_id");
+    attemptQuery.bindValue(":quiz_id", quizId);
+    attemptQuery.bindValue(":student_id", studentId);
+    attemptQuery.bindValue(":auto_score", autoScore);
+    attemptQuery.bindValue(":total_auto", static_cast<int>(totalAutoPoints));
+    attemptQuery.bindValue(":total_manual", openAnswerCount);
+
+    if (!attemptQuery.exec() || !attemptQuery.next()) {
+        qWarning() << "Failed to create quiz attempt:" << attemptQuery.lastError().text();
+        connection.rollback();
+        return result;
     }
+    int attemptId = attemptQuery.value(0).toInt();
 
-    if (!query.exec()) {
-        db.rollback();
-        QJsonObject result;
-        result["success"] = false;
+    // Write all graded answers with multi-row inserts. The statement text only depends on the
+    // number of rows, so quizzes of the same size share a cached statement.
+    constexpr int answersPerInsert = 100;
+    for (int first = 0; first < graded.size(); first += answersPerInsert) {
+        int rows = qMin(answersPerInsert, int(graded.size()) - first);
+
+        QStringList values;
+        for (int i = 0; i < rows; ++i) {
+            values.append("(?, ?, ?, ?, ?, 1.0)");
+        }
+
+        QSqlQuery &answersQuery = connection.prepare(
+            "INSERT INTO answers (attempt_id, question_id, student_response, is_correct, "
+            "points_earned, max_points) VALUES "
+            + values.join(", "));
+        for (int i = first; i < first + rows; ++i) {
+            const GradedAnswer &answer = graded.at(i);
+            answersQuery.addBindValue(attemptId);
+            answersQuery.addBindValue(answer.questionId);
+            answersQuery.addBindValue(answer.response);
+            answersQuery.addBindValue(answer.isCorrect);
+            answersQuery.addBindValue(answer.points);
+        }
+
+        if (!answersQuery.exec()) {
+            qWarning() << "Failed to save quiz answers:" << answersQuery.lastError().text();
+            connection.rollback();
+            return result;
+        }
+    }
+
+    QJsonObject event{{"event", "attempt_submitted"},
+                      {"attempt_id", attemptId},
+                      {"quiz_id", quizId},
+                      {"status", status}};
+    bool notified = notify(connection, QString("grades:%1").arg(studentId), event);
+    if (notified && hasOpenAnswers) {
+        notified = notify(connection,
+                          QString("pending_attempts:%1").arg(quiz->getCreatorId()),
+                          event);
+    }
+    if (!notified) {
+        connection.rollback();
         return result;
     }
 
-    db.commit();
+    if (!connection.commit()) {
+        return result;
+    }
 
-    // Prepare result
-    QJsonObject result;
     result["success"] = true;
+    result["attempt_id"] = attemptId;
     result["status"] = status;
     result["auto_score"] = autoScore;
     result["has_open_answers"] = hasOpenAnswers;
-    result["feedback_type"] = feedbackType;
-
+    result["feedback_type"] = quiz->getFeedbackType();
     return result;
 }
 
 QJsonObject DatabaseManager::getQuizAttemptDetails(int attemptId, int studentId)
 {
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return QJsonObject();
 
     // Get attempt info
-    QSqlQuery query(db);
-    query.prepare(
+    QSqlQuery &query = connection.prepare(
         "SELECT qa.*, q.feedback_type, cm.title "
         "FROM quiz_attempts qa "
         "JOIN quizzes q ON qa.quiz_id = q.quiz_id "
@@ -936,29 +1174,30 @@ QJsonObject DatabaseManager::getQuizAttemptDetails(int attemptId, int studentId)
     if (feedbackType != "score_only" || studentId == -1) {
         QJsonArray answersArray;
 
-        query.prepare("SELECT a.*, q.prompt, q.question_type "
-                      "FROM answers a "
-                      "JOIN questions q ON a.question_id = q.question_id "
-                      "WHERE a.attempt_id = :attempt_id "
-                      "ORDER BY a.question_id");
-        query.bindValue(":attempt_id", attemptId);
+        QSqlQuery &answersQuery = connection.prepare(
+            "SELECT a.*, q.prompt, q.question_type "
+            "FROM answers a "
+            "JOIN questions q ON a.question_id = q.question_id "
+            "WHERE a.attempt_id = :attempt_id "
+            "ORDER BY a.question_id");
+        answersQuery.bindValue(":attempt_id", attemptId);
 
-        if (query.exec()) {
-            while (query.next()) {
+        if (answersQuery.exec()) {
+            while (answersQuery.next()) {
                 QJsonObject answer;
-                int questionId = query.value("question_id").toInt();
-                QString questionType = query.value("question_type").toString();
-                QString studentResponse = query.value("student_response").toString();
+                int questionId = answersQuery.value("question_id").toInt();
+                QString questionType = answersQuery.value("question_type").toString();
+                QString studentResponse = answersQuery.value("student_response").toString();
 
                 answer["question_id"] = questionId;
-                answer["prompt"] = query.value("prompt").toString();
+                answer["prompt"] = answersQuery.value("prompt").toString();
                 answer["question_type"] = questionType;
                 answer["student_response"] = studentResponse;
 
                 if (questionType == "radio" || questionType == "checkbox") {
-                    QSqlQuery optionsQuery(db);
-                    optionsQuery.prepare("SELECT option_text FROM question_options WHERE "
-                                         "question_id = :qid ORDER BY option_id");
+                    QSqlQuery &optionsQuery = connection.prepare(
+                        "SELECT option_text FROM question_options WHERE "
+                        "question_id = :qid ORDER BY option_id");
                     optionsQuery.bindValue(":qid", questionId);
 
                     QStringList optionTexts;
@@ -984,20 +1223,20 @@ QJsonObject DatabaseManager::getQuizAttemptDetails(int attemptId, int studentId)
                     answer["student_response_text"] = studentResponse;
                 }
 
-                if (!query.value("is_correct").isNull()) {
-                    answer["is_correct"] = query.value("is_correct").toBool();
+                if (!answersQuery.value("is_correct").isNull()) {
+                    answer["is_correct"] = answersQuery.value("is_correct").toBool();
                 }
 
                 if (questionType == "open_answer" && status == "completed") {
-                    answer["points_earned"] = query.value("points_earned").toDouble();
+                    answer["points_earned"] = answersQuery.value("points_earned").toDouble();
                 }
                 // Include correct answers only if feedback type is "detailed_with_answers"
                 if ((feedbackType == "detailed_with_answers" || studentId == -1)
-                    && query.value("question_type").toString() != "open_answer") {
-                    QSqlQuery optionsQuery(db);
-                    optionsQuery.prepare("SELECT option_text FROM question_options "
-                                         "WHERE question_id = :qid AND is_correct = true");
-                    optionsQuery.bindValue(":qid", query.value("question_id").toInt());
+                    && answersQuery.value("question_type").toString() != "open_answer") {
+                    QSqlQuery &optionsQuery = connection.prepare(
+                        "SELECT option_text FROM question_options "
+                        "WHERE question_id = :qid AND is_correct = true");
+                    optionsQuery.bindValue(":qid", answersQuery.value("question_id").toInt());
 
                     if (optionsQuery.exec()) {
                         QJsonArray correctAnswers;
@@ -1018,33 +1257,60 @@ QJsonObject DatabaseManager::getQuizAttemptDetails(int attemptId, int studentId)
     return attemptInfo;
 }
 
-QJsonArray DatabaseManager::getStudentQuizAttempts(int studentId)
+QJsonArray DatabaseManager::getStudentQuizAttempts(int studentId,
+                                                   const PageRequest &page,
+                                                   QString *nextCursor)
 {
     QJsonArray attempts;
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return attempts;
 
-    QSqlQuery query(db);
-    query.prepare("SELECT qa.*, cm.title as quiz_title, q.feedback_type, c.course_id, "
-                  "c.course_name, cl.class_id, cl.class_name, u.username as instructor_name "
-                  "FROM quiz_attempts qa "
-                  "JOIN course_materials cm ON qa.quiz_id = cm.material_id "
-                  "JOIN quizzes q ON qa.quiz_id = q.quiz_id "
-                  "LEFT JOIN courses c ON cm.course_id = c.course_id "
-                  "LEFT JOIN classes cl ON c.class_id = cl.class_id "
-                  "LEFT JOIN users u ON cm.creator_id = u.user_id "
-                  "WHERE qa.student_id = :student_id "
-                  "ORDER BY qa.submitted_at DESC");
+    // Keyset: newest first by (submitted_at, attempt_id). The timestamp goes into the cursor as
+    // PostgreSQL's own text form so it keeps its full precision.
+    bool firstPage = page.after.isEmpty();
+    QSqlQuery &query = connection.prepare(
+        firstPage ? "SELECT qa.*, qa.submitted_at::text AS submitted_key, cm.title as quiz_title, "
+                    "q.feedback_type, c.course_id, c.course_name, cl.class_id, cl.class_name, "
+                    "u.username as instructor_name "
+                    "FROM quiz_attempts qa "
+                    "JOIN course_materials cm ON qa.quiz_id = cm.material_id "
+                    "JOIN quizzes q ON qa.quiz_id = q.quiz_id "
+                    "LEFT JOIN courses c ON cm.course_id = c.course_id "
+                    "LEFT JOIN classes cl ON c.class_id = cl.class_id "
+                    "LEFT JOIN users u ON cm.creator_id = u.user_id "
+                    "WHERE qa.student_id = :student_id "
+                    "ORDER BY qa.submitted_at DESC, qa.attempt_id DESC LIMIT :limit"
+                  : "SELECT qa.*, qa.submitted_at::text AS submitted_key, cm.title as quiz_title, "
+                    "q.feedback_type, c.course_id, c.course_name, cl.class_id, cl.class_name, "
+                    "u.username as instructor_name "
+                    "FROM quiz_attempts qa "
+                    "JOIN course_materials cm ON qa.quiz_id = cm.material_id "
+                    "JOIN quizzes q ON qa.quiz_id = q.quiz_id "
+                    "LEFT JOIN courses c ON cm.course_id = c.course_id "
+                    "LEFT JOIN classes cl ON c.class_id = cl.class_id "
+                    "LEFT JOIN users u ON cm.creator_id = u.user_id "
+                    "WHERE qa.student_id = :student_id AND (qa.submitted_at, qa.attempt_id) < "
+                    "(CAST(:after_submitted AS timestamp), :after_id) "
+                    "ORDER BY qa.submitted_at DESC, qa.attempt_id DESC LIMIT :limit");
     query.bindValue(":student_id", studentId);
+    if (!firstPage) {
+        query.bindValue(":after_submitted", page.after[0].toString());
+        query.bindValue(":after_id", page.after[1].toInt());
+    }
+    query.bindValue(":limit", page.limit + 1);
 
     if (!query.exec()) {
         qWarning() << "Failed to get student quiz attempts:" << query.lastError().text();
         return attempts;
     }
 
+    QJsonArray lastKey;
     while (query.next()) {
+        if (attempts.size() == page.limit) {
+            *nextCursor = PageRequest::encodeCursor(lastKey);
+            break;
+        }
         QJsonObject obj;
         obj["attempt_id"] = query.value("attempt_id").toInt();
         obj["quiz_id"] = query.value("quiz_id").toInt();
@@ -1061,6 +1327,7 @@ QJsonArray DatabaseManager::getStudentQuizAttempts(int studentId)
         obj["class_name"] = query.value("class_name").toString();
         obj["instructor_name"] = query.value("instructor_name").toString();
         attempts.append(obj);
+        lastKey = {query.value("submitted_key").toString(), obj["attempt_id"]};
     }
 
     return attempts;
@@ -1068,51 +1335,70 @@ QJsonArray DatabaseManager::getStudentQuizAttempts(int studentId)
 
 bool DatabaseManager::finalizeAttempt(int attemptId, const QString &status, float score)
 {
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return false;
 
-    QSqlQuery query(db);
     if (score >= 0) {
-        query.prepare("UPDATE quiz_attempts SET status = :status, final_score = :score, "
-                      "graded_at = CURRENT_TIMESTAMP WHERE attempt_id = :id");
+        QSqlQuery &query = connection.prepare(
+            "UPDATE quiz_attempts SET status = :status, final_score = :score, "
+            "graded_at = CURRENT_TIMESTAMP WHERE attempt_id = :id");
         query.bindValue(":score", score);
-    } else {
-        query.prepare("UPDATE quiz_attempts SET status = :status WHERE attempt_id = :id");
+        query.bindValue(":status", status);
+        query.bindValue(":id", attemptId);
+        return query.exec();
     }
+
+    QSqlQuery &query = connection.prepare(
+        "UPDATE quiz_attempts SET status = :status WHERE attempt_id = :id");
     query.bindValue(":status", status);
     query.bindValue(":id", attemptId);
-
     return query.exec();
 }
 
-QJsonArray DatabaseManager::getPendingAttempts(int instructorId)
+QJsonArray DatabaseManager::getPendingAttempts(int instructorId,
+                                               const PageRequest &page,
+                                               QString *nextCursor)
 {
     QJsonArray attempts;
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return attempts;
 
-    QSqlQuery query(db);
-    query.prepare("SELECT qa.attempt_id, qa.quiz_id, qa.student_id, qa.attempt_number, "
-                  "qa.auto_score, qa.total_auto_points, qa.total_manual_points, "
-                  "u.username, cm.title, c.course_name, cl.class_name "
-                  "FROM quiz_attempts qa "
-                  "JOIN users u ON qa.student_id = u.user_id "
-                  "JOIN course_materials cm ON qa.quiz_id = cm.material_id "
-                  "LEFT JOIN courses c ON cm.course_id = c.course_id "
-                  "LEFT JOIN classes cl ON c.class_id = cl.class_id "
-                  "WHERE qa.status = 'pending_manual_grading' AND cm.creator_id = :instructor_id "
-                  "ORDER BY qa.attempt_id");
+    // One row per ungraded open answer, joined in a single statement.
+    // Keyset: (attempt_id, question_id); ids start at 1, so the first page continues after (0, 0)
+    QSqlQuery &query = connection.prepare(
+        "SELECT qa.attempt_id, qa.quiz_id, qa.student_id, qa.attempt_number, "
+        "qa.auto_score, qa.total_auto_points, qa.total_manual_points, "
+        "u.username, cm.title, c.course_name, cl.class_name, "
+        "q.question_id, q.prompt, a.student_response "
+        "FROM quiz_attempts qa "
+        "JOIN users u ON qa.student_id = u.user_id "
+        "JOIN course_materials cm ON qa.quiz_id = cm.material_id "
+        "JOIN answers a ON a.attempt_id = qa.attempt_id "
+        "JOIN questions q ON a.question_id = q.question_id "
+        "LEFT JOIN courses c ON cm.course_id = c.course_id "
+        "LEFT JOIN classes cl ON c.class_id = cl.class_id "
+        "WHERE qa.status = 'pending_manual_grading' AND cm.creator_id = :instructor_id "
+        "AND q.question_type = 'open_answer' AND a.points_earned IS NULL "
+        "AND (qa.attempt_id, q.question_id) > (:after_attempt, :after_question) "
+        "ORDER BY qa.attempt_id, q.question_id LIMIT :limit");
     query.bindValue(":instructor_id", instructorId);
+    query.bindValue(":after_attempt", page.after.isEmpty() ? 0 : page.after[0].toInt());
+    query.bindValue(":after_question", page.after.isEmpty() ? 0 : page.after[1].toInt());
+    query.bindValue(":limit", page.limit + 1);
 
     if (!query.exec()) {
+        qWarning() << "Failed to get pending attempts:" << query.lastError().text();
         return attempts;
     }
 
     while (query.next()) {
+        if (attempts.size() == page.limit) {
+            QJsonObject last = attempts.last().toObject();
+            *nextCursor = PageRequest::encodeCursor({last["attempt_id"], last["question_id"]});
+            break;
+        }
         QJsonObject obj;
         obj["attempt_id"] = query.value("attempt_id").toInt();
         obj["quiz_id"] = query.value("quiz_id").toInt();
@@ -1125,23 +1411,10 @@ QJsonArray DatabaseManager::getPendingAttempts(int instructorId)
         obj["auto_score"] = query.value("auto_score").toDouble();
         obj["total_auto_points"] = query.value("total_auto_points").toInt();
         obj["total_manual_points"] = query.value("total_manual_points").toInt();
-
-        QSqlQuery questionsQuery(db);
-        questionsQuery.prepare("SELECT q.question_id, q.prompt, a.student_response FROM answers a "
-                               "JOIN questions q ON a.question_id = q.question_id "
-                               "WHERE a.attempt_id = :attempt_id AND q.question_type = "
-                               "'open_answer' AND a.points_earned IS NULL");
-        questionsQuery.bindValue(":attempt_id", obj["attempt_id"].toInt());
-
-        if (questionsQuery.exec()) {
-            while (questionsQuery.next()) {
-                QJsonObject questionObj = obj; // Copy attempt data
-                questionObj["question_id"] = questionsQuery.value("question_id").toInt();
-                questionObj["prompt"] = questionsQuery.value("prompt").toString();
-                questionObj["student_response"] = questionsQuery.value("student_response").toString();
-                attempts.append(questionObj);
-            }
-        }
+        obj["question_id"] = query.value("question_id").toInt();
+        obj["prompt"] = query.value("prompt").toString();
+        obj["student_response"] = query.value("student_response").toString();
+        attempts.append(obj);
     }
 
     return attempts;
@@ -1149,56 +1422,78 @@ QJsonArray DatabaseManager::getPendingAttempts(int instructorId)
 
 bool DatabaseManager::submitGrade(int attemptId, int questionId, float score)
 {
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return false;
 
-    db.transaction();
+    connection.transaction();
 
     // Update points_earned for the specific open answer question
-    QSqlQuery updateAnswerQuery(db);
-    updateAnswerQuery.prepare("UPDATE answers SET points_earned = :points "
-                              "WHERE attempt_id = :attempt_id AND question_id = :question_id");
+    QSqlQuery &updateAnswerQuery = connection.prepare(
+        "UPDATE answers SET points_earned = :points "
+        "WHERE attempt_id = :attempt_id AND question_id = :question_id");
     updateAnswerQuery.bindValue(":points", score / 100.0);
     updateAnswerQuery.bindValue(":attempt_id", attemptId);
     updateAnswerQuery.bindValue(":question_id", questionId);
 
     if (!updateAnswerQuery.exec()) {
-        db.rollback();
+        connection.rollback();
+        return false;
+    }
+
+    // Tell the quiz's instructor sessions that this answer left the grading queue
+    QSqlQuery &ownersQuery = connection.prepare(
+        "SELECT qa.student_id, cm.creator_id FROM quiz_attempts qa "
+        "JOIN course_materials cm ON qa.quiz_id = cm.material_id "
+        "WHERE qa.attempt_id = :id");
+    ownersQuery.bindValue(":id", attemptId);
+    if (!ownersQuery.exec() || !ownersQuery.next()) {
+        connection.rollback();
+        return false;
+    }
+    int studentId = ownersQuery.value("student_id").toInt();
+    int instructorId = ownersQuery.value("creator_id").toInt();
+    ownersQuery.finish();
+
+    if (!notify(connection,
+                QString("pending_attempts:%1").arg(instructorId),
+                {{"event", "answer_graded"},
+                 {"attempt_id", attemptId},
+                 {"question_id", questionId}})) {
+        connection.rollback();
         return false;
     }
 
     // Check if there are any other ungraded open questions for this attempt
-    QSqlQuery checkPendingQuery(db);
-    checkPendingQuery.prepare("SELECT COUNT(*) FROM answers a "
-                              "JOIN questions q ON a.question_id = q.question_id "
-                              "WHERE a.attempt_id = :attempt_id "
-                              "AND q.question_type = 'open_answer' "
-                              "AND a.points_earned IS NULL");
+    QSqlQuery &checkPendingQuery = connection.prepare(
+        "SELECT COUNT(*) FROM answers a "
+        "JOIN questions q ON a.question_id = q.question_id "
+        "WHERE a.attempt_id = :attempt_id "
+        "AND q.question_type = 'open_answer' "
+        "AND a.points_earned IS NULL");
     checkPendingQuery.bindValue(":attempt_id", attemptId);
 
     if (!checkPendingQuery.exec() || !checkPendingQuery.next()) {
-        db.rollback();
+        connection.rollback();
         return false;
     }
 
     int pendingCount = checkPendingQuery.value(0).toInt();
     if (pendingCount > 0) {
         // Still pending questions, just commit the grade for the current question
-        db.commit();
+        connection.commit();
         return true;
     }
 
     // All open questions are graded, so calculate final score and update status
     // Get current auto score and point totals
-    QSqlQuery query(db);
-    query.prepare("SELECT auto_score, total_auto_points, total_manual_points "
-                  "FROM quiz_attempts WHERE attempt_id = :id");
+    QSqlQuery &query = connection.prepare(
+        "SELECT auto_score, total_auto_points, total_manual_points "
+        "FROM quiz_attempts WHERE attempt_id = :id");
     query.bindValue(":id", attemptId);
 
     if (!query.exec() || !query.next()) {
-        db.rollback();
+        connection.rollback();
         return false;
     }
 
@@ -1207,12 +1502,13 @@ bool DatabaseManager::submitGrade(int attemptId, int questionId, float score)
     int totalManualPoints = query.value("total_manual_points").toInt();
 
     // Recalculate manual score
-    query.prepare("SELECT SUM(points_earned) FROM answers WHERE attempt_id = :id AND question_id "
-                  "IN (SELECT question_id FROM questions WHERE question_type = 'open_answer')");
-    query.bindValue(":id", attemptId);
+    QSqlQuery &manualQuery = connection.prepare(
+        "SELECT SUM(points_earned) FROM answers WHERE attempt_id = :id AND question_id "
+        "IN (SELECT question_id FROM questions WHERE question_type = 'open_answer')");
+    manualQuery.bindValue(":id", attemptId);
     float totalManualPointsEarned = 0;
-    if (query.exec() && query.next()) {
-        totalManualPointsEarned = query.value(0).toFloat();
+    if (manualQuery.exec() && manualQuery.next()) {
+        totalManualPointsEarned = manualQuery.value(0).toFloat();
     }
 
     float manualScore = (totalManualPoints > 0)
@@ -1232,31 +1528,40 @@ bool DatabaseManager::submitGrade(int attemptId, int questionId, float score)
     }
 
     // Update the attempt with manual score and final score
-    query.prepare("UPDATE quiz_attempts SET status = 'completed', manual_score = :manual, "
-                  "final_score = :final, graded_at = CURRENT_TIMESTAMP WHERE attempt_id = :id");
-    query.bindValue(":manual", manualScore);
-    query.bindValue(":final", finalScore);
-    query.bindValue(":id", attemptId);
+    QSqlQuery &updateQuery = connection.prepare(
+        "UPDATE quiz_attempts SET status = 'completed', manual_score = :manual, "
+        "final_score = :final, graded_at = CURRENT_TIMESTAMP WHERE attempt_id = :id");
+    updateQuery.bindValue(":manual", manualScore);
+    updateQuery.bindValue(":final", finalScore);
+    updateQuery.bindValue(":id", attemptId);
+
+    if (!updateQuery.exec()) {
+        connection.rollback();
+        return false;
+    }
 
-    if (!query.exec()) {
-        db.rollback();
+    if (!notify(connection,
+                QString("grades:%1").arg(studentId),
+                {{"event", "attempt_graded"},
+                 {"attempt_id", attemptId},
+                 {"status", "completed"},
+                 {"final_score", finalScore}})) {
+        connection.rollback();
         return false;
     }
 
-    db.commit();
+    connection.commit();
     return true;
 }
 
 int DatabaseManager::getAttemptCount(int quizId, int studentId)
 {
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return 0;
 
-    QSqlQuery query(db);
-    query.prepare("SELECT COUNT(*) FROM quiz_attempts "
-                  "WHERE quiz_id = :quiz_id AND student_id = :student_id");
+    QSqlQuery &query = connection.prepare("SELECT COUNT(*) FROM quiz_attempts "
+                                          "WHERE quiz_id = :quiz_id AND student_id = :student_id");
     query.bindValue(":quiz_id", quizId);
     query.bindValue(":student_id", studentId);
 
@@ -1267,22 +1572,37 @@ int DatabaseManager::getAttemptCount(int quizId, int studentId)
     return query.value(0).toInt();
 }
 
-QJsonArray DatabaseManager::getStudentAttemptsForQuiz(int quizId)
+QJsonArray DatabaseManager::getStudentAttemptsForQuiz(int quizId,
+                                                      const PageRequest &page,
+                                                      QString *nextCursor)
 {
     QJsonArray attempts;
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return attempts;
 
-    QSqlQuery query(db);
-    query.prepare(
-        "SELECT qa.attempt_id, qa.attempt_number, qa.final_score, u.username as student_name "
-        "FROM quiz_attempts qa "
-        "JOIN users u ON qa.student_id = u.user_id "
-        "WHERE qa.quiz_id = :quiz_id "
-        "ORDER BY u.username, qa.attempt_number");
+    // Keyset: (username, attempt_number), unique within a quiz
+    bool firstPage = page.after.isEmpty();
+    QSqlQuery &query = connection.prepare(
+        firstPage ? "SELECT qa.attempt_id, qa.attempt_number, qa.final_score, "
+                    "u.username as student_name "
+                    "FROM quiz_attempts qa "
+                    "JOIN users u ON qa.student_id = u.user_id "
+                    "WHERE qa.quiz_id = :quiz_id "
+                    "ORDER BY u.username, qa.attempt_number LIMIT :limit"
+                  : "SELECT qa.attempt_id, qa.attempt_number, qa.final_score, "
+                    "u.username as student_name "
+                    "FROM quiz_attempts qa "
+                    "JOIN users u ON qa.student_id = u.user_id "
+                    "WHERE qa.quiz_id = :quiz_id "
+                    "AND (u.username, qa.attempt_number) > (:after_username, :after_number) "
+                    "ORDER BY u.username, qa.attempt_number LIMIT :limit");
     query.bindValue(":quiz_id", quizId);
+    if (!firstPage) {
+        query.bindValue(":after_username", page.after[0].toString());
+        query.bindValue(":after_number", page.after[1].toInt());
+    }
+    query.bindValue(":limit", page.limit + 1);
 
     if (!query.exec()) {
         qWarning() << "Failed to get student attempts for quiz:" << query.lastError().text();
@@ -1290,6 +1610,11 @@ QJsonArray DatabaseManager::getStudentAttemptsForQuiz(int quizId)
     }
 
     while (query.next()) {
+        if (attempts.size() == page.limit) {
+            QJsonObject last = attempts.last().toObject();
+            *nextCursor = PageRequest::encodeCursor({last["student_name"], last["attempt_number"]});
+            break;
+        }
         QJsonObject obj;
         obj["attempt_id"] = query.value("attempt_id").toInt();
         obj["attempt_number"] = query.value("attempt_number").toInt();
@@ -1304,30 +1629,29 @@ QJsonArray DatabaseManager::getStudentAttemptsForQuiz(int quizId)
 QJsonObject DatabaseManager::getClassStatistics(int classId)
 {
     QJsonObject stats;
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return stats;
 
-    QSqlQuery query(db);
-
     // Get student count
-    query.prepare("SELECT COUNT(user_id) FROM class_members WHERE class_id = :class_id AND user_id "
-                  "IN (SELECT user_id FROM users WHERE role = 'student')");
-    query.bindValue(":class_id", classId);
-    if (query.exec() && query.next()) {
-        stats["student_count"] = query.value(0).toInt();
+    QSqlQuery &countQuery = connection.prepare(
+        "SELECT COUNT(user_id) FROM class_members WHERE class_id = :class_id AND user_id "
+        "IN (SELECT user_id FROM users WHERE role = 'student')");
+    countQuery.bindValue(":class_id", classId);
+    if (countQuery.exec() && countQuery.next()) {
+        stats["student_count"] = countQuery.value(0).toInt();
     }
 
     // Get average score
-    query.prepare("SELECT AVG(qa.final_score) "
-                  "FROM quiz_attempts qa "
-                  "JOIN users u ON qa.student_id = u.user_id "
-                  "JOIN class_members cm ON u.user_id = cm.user_id "
-                  "WHERE cm.class_id = :class_id AND qa.final_score IS NOT NULL");
-    query.bindValue(":class_id", classId);
-    if (query.exec() && query.next()) {
-        stats["average_score"] = query.value(0).toDouble();
+    QSqlQuery &averageQuery = connection.prepare(
+        "SELECT AVG(qa.final_score) "
+        "FROM quiz_attempts qa "
+        "JOIN users u ON qa.student_id = u.user_id "
+        "JOIN class_members cm ON u.user_id = cm.user_id "
+        "WHERE cm.class_id = :class_id AND qa.final_score IS NOT NULL");
+    averageQuery.bindValue(":class_id", classId);
+    if (averageQuery.exec() && averageQuery.next()) {
+        stats["average_score"] = averageQuery.value(0).toDouble();
     }
 
     return stats;
@@ -1336,32 +1660,50 @@ QJsonObject DatabaseManager::getClassStatistics(int classId)
 QJsonObject DatabaseManager::getCourseStatistics(int courseId)
 {
     QJsonObject stats;
-    QMutexLocker locker(&m_mutex);
-    QSqlDatabase db = getDatabase();
-    if (!db.open())
+    PooledConnection connection = m_pool.acquire();
+    if (!connection.isValid())
         return stats;
 
-    QSqlQuery query(db);
-
     // Get student count (students who have at least one attempt in this course)
-    query.prepare("SELECT COUNT(DISTINCT qa.student_id) "
-                  "FROM quiz_attempts qa "
-                  "JOIN course_materials cm ON qa.quiz_id = cm.material_id "
-                  "WHERE cm.course_id = :course_id");
-    query.bindValue(":course_id", courseId);
-    if (query.exec() && query.next()) {
-        stats["student_count"] = query.value(0).toInt();
+    QSqlQuery &countQuery = connection.prepare(
+        "SELECT COUNT(DISTINCT qa.student_id) "
+        "FROM quiz_attempts qa "
+        "JOIN course_materials cm ON qa.quiz_id = cm.material_id "
+        "WHERE cm.course_id = :course_id");
+    countQuery.bindValue(":course_id", courseId);
+    if (countQuery.exec() && countQuery.next()) {
+        stats["student_count"] = countQuery.value(0).toInt();
     }
 
     // Get average score
-    query.prepare("SELECT AVG(qa.final_score) "
-                  "FROM quiz_attempts qa "
-                  "JOIN course_materials cm ON qa.quiz_id = cm.material_id "
-                  "WHERE cm.course_id = :course_id AND qa.final_score IS NOT NULL");
-    query.bindValue(":course_id", courseId);
-    if (query.exec() && query.next()) {
-        stats["average_score"] = query.value(0).toDouble();
+    QSqlQuery &averageQuery = connection.prepare(
+        "SELECT AVG(qa.final_score) "
+        "FROM quiz_attempts qa "
+        "JOIN course_materials cm ON qa.quiz_id = cm.material_id "
+        "WHERE cm.course_id = :course_id AND qa.final_score IS NOT NULL");
+    averageQuery.bindValue(":course_id", courseId);
+    if (averageQuery.exec() && averageQuery.next()) {
+        stats["average_score"] = averageQuery.value(0).toDouble();
     }
 
     return stats;
 }
+
+bool DatabaseManager::notify(PooledConnection &connection,
+                             const QString &topic,
+                             const QJsonObject &event)
+{
+    QJsonObject message;
+    message["topic"] = topic;
+    message["event"] = event;
+
+    QSqlQuery &query = connection.prepare("SELECT pg_notify(:channel, :payload)");
+    query.bindValue(":channel", QString::fromLatin1(NotificationChannel));
+    query.bindValue(":payload",
+                    QString::fromUtf8(QJsonDocument(message).toJson(QJsonDocument::Compact)));
+    if (!query.exec()) {
+        qWarning() << "Failed to publish change event:" << query.lastError().text();
+        return false;
+    }
+    return true;
+}
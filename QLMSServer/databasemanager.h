@@ -1,11 +1,16 @@
 #ifndef DATABASEMANAGER_H
 #define DATABASEMANAGER_H
 
+#include "commandscheduler.h"
+#include "connectionpool.h"
+#include "pagination.h"
+#include "quizcache.h"
+#include "versionregistry.h"
 #include <memory>
 #include <QJsonArray>
 #include <QJsonObject>
-#include <QMutex>
 #include <QObject>
+#include <QPair>
 #include <QSqlDatabase>
 
 class User;
@@ -20,18 +25,42 @@ class DatabaseManager : public QObject
 public:
     static DatabaseManager &instance();
 
-    bool initialize(const QString &host,
-                    int port,
-                    const QString &databaseName,
-                    const QString &username,
-                    const QString &password);
+    // pg_notify() channel carrying change events to the NotificationHub
+    static constexpr char NotificationChannel[] = "qlms_events";
+
+    // Connections kept free for critical commands unless setSchedulerLimits() says otherwise
+    static constexpr int DefaultCriticalReserve = 2;
+
+    bool initialize(const ConnectionPoolOptions &options);
+    QJsonObject statistics() const;
+
+    // Runs blocking database work on the executor so client event loops keep serving sockets.
+    // Continuations attached with QFuture::then(context, ...) run back on the caller's thread.
+    // The priority decides which queued work gets the next free connection.
+    template<typename Function>
+    auto runAsync(CommandPriority priority, Function &&function)
+    {
+        return m_scheduler.run(priority, std::forward<Function>(function));
+    }
+
+    // Connections kept free for critical commands, and the most bulk commands may hold at once
+    void setSchedulerLimits(int criticalReserve, int bulkConnections);
+
+    // Makes the database calls of the current thread share one pooled connection until the
+    // returned scope is destroyed
+    ConnectionScope connectionScope();
+
+    // List operations return at most page.limit rows and set nextCursor when more follow
 
     // User operations
     std::shared_ptr<User> authenticateUser(const QString &username, const QString &passwordHash);
     std::shared_ptr<User> getUserById(int userId);
     bool createUser(const QString &username, const QString &passwordHash, const QString &role);
     bool deleteUser(int userId);
-    QList<std::shared_ptr<User>> getAllUsers();
+    // Users whose name contains search, ignoring case; every user if search is empty
+    QList<std::shared_ptr<User>> getAllUsers(const PageRequest &page,
+                                             QString *nextCursor,
+                                             const QString &search = QString());
 
     // Class operations
     QJsonArray getAllClasses();
@@ -40,32 +69,49 @@ public:
     bool deleteClass(int classId);
     bool assignUserToClass(int userId, int classId);
     bool removeUserFromClass(int userId, int classId);
-    QJsonArray getClassMembers(int classId);
+    QJsonArray getClassMembers(int classId, const PageRequest &page, QString *nextCursor);
+
+    // Classes with their courses (depth >= 2) and material metadata (depth 3), built with one
+    // query per level. userId -1 means every class; withContent adds lesson text and quiz
+    // settings to the materials.
+    QJsonArray getClassTree(int userId, int depth, bool withContent);
 
     // Course operations
     QJsonArray getCoursesForClass(int classId);
+    // True if the user belongs to the class the course is part of
+    bool isCourseMember(int userId, int courseId);
     bool createCourse(const QString &courseName, int classId);
     bool deleteCourse(int courseId);
 
     // Course material operations
-    QList<std::shared_ptr<CourseMaterial>> getAllMaterials();
-    std::shared_ptr<CourseMaterial> getMaterialById(int materialId);
+    QList<std::shared_ptr<const CourseMaterial>> getAllMaterials();
+    std::shared_ptr<const CourseMaterial> getMaterialById(int materialId);
     bool deleteMaterial(int materialId);
     bool createLesson(const QString &title, const QString &content, int courseId, int creatorId);
     bool createQuizWithQuestions(const QJsonObject &quizData, int courseId, int creatorId);
     QJsonArray getMaterialsForCourse(int courseId);
+    // Up to length characters of lesson text starting at offset, read without loading the rest
+    // of the lesson. "done" is set once the chunk reaches the end of the text.
+    QJsonObject getLessonChunk(int lessonId, qint64 offset, int length);
+
+    // Quiz definitions are served from the quiz cache; writes through this class invalidate it
+    std::shared_ptr<const Quiz> getQuiz(int quizId);
+    void setQuizCacheLimits(int maxEntries, qint64 maxBytes);
+
+    // Version stamps for conditional fetches: "classes", "class:<id>" (its courses),
+    // "course:<id>" (its materials), "material:<id>" and "tree". Writes bump them.
+    VersionRegistry &versions() { return m_versions; }
 
     // Quiz attempt operations
-    int createQuizAttempt(int quizId, int studentId, int attemptNumber);
-    bool saveAnswer(int attemptId, int questionId, const QString &response);
-    QJsonObject autoGradeQuizAttempt(int attemptId);
+    // Grades the answers against the quiz and stores the attempt in a single transaction
+    QJsonObject submitQuizAttempt(int quizId, int studentId, const QJsonArray &answers);
     bool finalizeAttempt(int attemptId, const QString &status, float score = -1);
-    QJsonArray getPendingAttempts(int instructorId);
+    QJsonArray getPendingAttempts(int instructorId, const PageRequest &page, QString *nextCursor);
     bool submitGrade(int attemptId, int questionId, float score);
     int getAttemptCount(int quizId, int studentId);
-    QJsonArray getStudentQuizAttempts(int studentId);
+    QJsonArray getStudentQuizAttempts(int studentId, const PageRequest &page, QString *nextCursor);
     QJsonObject getQuizAttemptDetails(int attemptId, int studentId = -1);
-    QJsonArray getStudentAttemptsForQuiz(int quizId);
+    QJsonArray getStudentAttemptsForQuiz(int quizId, const PageRequest &page, QString *nextCursor);
     QJsonObject getClassStatistics(int classId);
     QJsonObject getCourseStatistics(int courseId);
 
@@ -75,20 +121,20 @@ private:
     DatabaseManager(const DatabaseManager &) = delete;
     DatabaseManager &operator=(const DatabaseManager &) = delete;
 
-    QSqlDatabase getDatabase();
     std::shared_ptr<User> createUserFromQuery(const QSqlQuery &query);
-    std::shared_ptr<CourseMaterial> createMaterialFromQuery(const QSqlQuery &query,
-                                                            QSqlDatabase &db);
-    std::shared_ptr<Quiz> loadQuizDetails(int quizId);
-    std::shared_ptr<Question> createQuestionFromQuery(const QSqlQuery &query, QSqlDatabase &db);
-
-    QString m_connectionPrefix;
-    QString m_host;
-    int m_port;
-    QString m_databaseName;
-    QString m_username;
-    QString m_password;
-    QMutex m_mutex;
+    std::shared_ptr<const CourseMaterial> createMaterialFromQuery(const QSqlQuery &query,
+                                                                  PooledConnection &connection);
+    std::shared_ptr<const Quiz> cachedQuiz(int quizId, PooledConnection &connection);
+    std::shared_ptr<const Quiz> loadQuizDetails(int quizId, PooledConnection &connection);
+    std::shared_ptr<Question> createQuestionFromQuery(const QSqlQuery &query,
+                                                      const QList<QPair<QString, bool>> &options);
+    // Queues a change event; inside a transaction it is only sent if the transaction commits
+    bool notify(PooledConnection &connection, const QString &topic, const QJsonObject &event);
+
+    ConnectionPool m_pool;
+    CommandScheduler m_scheduler;
+    QuizCache m_quizCache;
+    VersionRegistry m_versions;
 };
 
 #endif // DATABASEMANAGER_H
@@ -0,0 +1,81 @@
+#include "eventlooppool.h"
+#include <QDebug>
+#include <QThread>
+
+EventLoopPool::EventLoopPool(int threadCount, QObject *parent)
+    : QObject(parent)
+{
+    if (threadCount <= 0) {
+        threadCount = QThread::idealThreadCount();
+    }
+
+    for (int i = 0; i < threadCount; ++i) {
+        auto *thread = new QThread();
+        thread->setObjectName(QString("ClientLoop-%1").arg(i));
+        m_loops.append({thread, 0});
+    }
+}
+
+EventLoopPool::~EventLoopPool()
+{
+    stop();
+    for (const Loop &loop : m_loops) {
+        delete loop.thread;
+    }
+}
+
+void EventLoopPool::start()
+{
+    for (const Loop &loop : m_loops) {
+        loop.thread->start();
+    }
+    qInfo() << "Started" << m_loops.size() << "client event loop threads";
+}
+
+void EventLoopPool::stop()
+{
+    for (const Loop &loop : m_loops) {
+        loop.thread->quit();
+    }
+    for (const Loop &loop : m_loops) {
+        loop.thread->wait();
+    }
+}
+
+QThread *EventLoopPool::assign()
+{
+    if (m_loops.isEmpty()) {
+        return nullptr;
+    }
+
+    int best = m_nextLoop % m_loops.size();
+    for (int i = 1; i < m_loops.size(); ++i) {
+        int candidate = (m_nextLoop + i) % m_loops.size();
+        if (m_loops[candidate].connections < m_loops[best].connections) {
+            best = candidate;
+        }
+    }
+
+    m_nextLoop = best + 1;
+    ++m_loops[best].connections;
+    return m_loops[best].thread;
+}
+
+void EventLoopPool::release(QThread *thread)
+{
+    for (Loop &loop : m_loops) {
+        if (loop.thread == thread) {
+            --loop.connections;
+            return;
+        }
+    }
+}
+
+QList<int> EventLoopPool::connectionCounts() const
+{
+    QList<int> counts;
+    for (const Loop &loop : m_loops) {
+        counts.append(loop.connections);
+    }
+    return counts;
+}
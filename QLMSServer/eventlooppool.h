@@ -0,0 +1,41 @@
+#ifndef EVENTLOOPPOOL_H
+#define EVENTLOOPPOOL_H
+
+#include <QList>
+#include <QObject>
+
+class QThread;
+
+// Fixed set of threads running event loops that client connections are spread across.
+// Only the thread that owns the pool may assign and release loops.
+class EventLoopPool : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit EventLoopPool(int threadCount, QObject *parent = nullptr);
+    ~EventLoopPool();
+
+    void start();
+    void stop();
+
+    int threadCount() const { return m_loops.size(); }
+
+    // Picks the loop with the fewest connections, rotating between equally loaded ones
+    QThread *assign();
+    void release(QThread *thread);
+
+    QList<int> connectionCounts() const;
+
+private:
+    struct Loop
+    {
+        QThread *thread;
+        int connections;
+    };
+
+    QList<Loop> m_loops;
+    int m_nextLoop = 0;
+};
+
+#endif // EVENTLOOPPOOL_H
@@ -1,5 +1,8 @@
+#include "admissioncontroller.h"
 #include "databasemanager.h"
+#include "notificationhub.h"
 #include "server.h"
+#include "sessiontokens.h"
 #include <QCommandLineParser>
 #include <QCoreApplication>
 #include <QDebug>
@@ -48,20 +51,213 @@ int main(int argc, char *argv[])
                                     "postgres");
     parser.addOption(dbPassOption);
 
+    QCommandLineOption poolMinOption("db-pool-min",
+                                     "Idle database connections kept open (default: 2)",
+                                     "count",
+                                     "2");
+    parser.addOption(poolMinOption);
+
+    QCommandLineOption poolMaxOption("db-pool-max",
+                                     "Maximum database connections (default: 16)",
+                                     "count",
+                                     "16");
+    parser.addOption(poolMaxOption);
+
+    QCommandLineOption poolTimeoutOption("db-pool-timeout",
+                                         "Maximum wait for a free database connection in "
+                                         "milliseconds (default: 5000)",
+                                         "ms",
+                                         "5000");
+    parser.addOption(poolTimeoutOption);
+
+    QCommandLineOption criticalReserveOption("db-critical-reserve",
+                                             "Database connections only quiz submissions, logins "
+                                             "and other critical commands may use (default: 2)",
+                                             "count",
+                                             "2");
+    parser.addOption(criticalReserveOption);
+
+    QCommandLineOption bulkConnectionsOption("db-bulk-max",
+                                             "Database connections reports and other bulk "
+                                             "commands may use at once (default: a quarter of "
+                                             "--db-pool-max)",
+                                             "count",
+                                             "0");
+    parser.addOption(bulkConnectionsOption);
+
+    QCommandLineOption quizCacheEntriesOption("quiz-cache-entries",
+                                              "Maximum quizzes kept in memory (default: 256)",
+                                              "count",
+                                              "256");
+    parser.addOption(quizCacheEntriesOption);
+
+    QCommandLineOption quizCacheSizeOption("quiz-cache-mb",
+                                           "Approximate memory limit of the quiz cache in MiB "
+                                           "(default: 64)",
+                                           "MiB",
+                                           "64");
+    parser.addOption(quizCacheSizeOption);
+
+    QCommandLineOption threadsOption(QStringList() << "t" << "threads",
+                                     "Client event loop threads (default: number of CPU cores)",
+                                     "count",
+                                     "0");
+    parser.addOption(threadsOption);
+
+    QCommandLineOption statsIntervalOption("stats-interval",
+                                           "Seconds between statistics log lines, 0 to disable "
+                                           "(default: 60)",
+                                           "seconds",
+                                           "60");
+    parser.addOption(statsIntervalOption);
+
+    QCommandLineOption maxMessageSizeOption("max-message-size",
+                                            "Largest accepted request in bytes (default: 16777216)",
+                                            "bytes",
+                                            "16777216");
+    parser.addOption(maxMessageSizeOption);
+
+    QCommandLineOption maxPipelinedOption("max-pipelined",
+                                          "Commands one client may have running at once "
+                                          "(default: 8)",
+                                          "count",
+                                          "8");
+    parser.addOption(maxPipelinedOption);
+
+    QCommandLineOption compressionThresholdOption("compress-threshold",
+                                                  "Compress responses of at least this many bytes "
+                                                  "for clients that support it, 0 to disable "
+                                                  "(default: 4096)",
+                                                  "bytes",
+                                                  "4096");
+    parser.addOption(compressionThresholdOption);
+
+    QCommandLineOption outputHighWaterOption("output-high-water",
+                                             "Unsent response bytes at which the server stops "
+                                             "reading a client's requests; reading resumes "
+                                             "below a quarter of it (default: 1048576)",
+                                             "bytes",
+                                             "1048576");
+    parser.addOption(outputHighWaterOption);
+
+    QCommandLineOption maxQueuedOption("max-queued",
+                                       "Requests one client may have waiting before the server "
+                                       "stops reading from it (default: 64)",
+                                       "count",
+                                       "64");
+    parser.addOption(maxQueuedOption);
+
+    QCommandLineOption maxQueuedBytesOption("max-queued-bytes",
+                                            "Received but undecoded request bytes at which the "
+                                            "server stops reading from a client (default: "
+                                            "4194304)",
+                                            "bytes",
+                                            "4194304");
+    parser.addOption(maxQueuedBytesOption);
+
+    QCommandLineOption interactiveRateOption("rate-interactive",
+                                             "Interactive commands per second one client may "
+                                             "send before getting BUSY, 0 for no limit "
+                                             "(default: 50)",
+                                             "rate",
+                                             "50");
+    parser.addOption(interactiveRateOption);
+
+    QCommandLineOption bulkRateOption("rate-bulk",
+                                      "Reports and other bulk commands per second one client "
+                                      "may send, 0 for no limit (default: 5)",
+                                      "rate",
+                                      "5");
+    parser.addOption(bulkRateOption);
+
+    QCommandLineOption maxLoadOption("max-load",
+                                     "Commands running or waiting for the database at which "
+                                     "the server answers BUSY; bulk commands are turned away "
+                                     "at half of it (default: 4 per database connection)",
+                                     "count",
+                                     "0");
+    parser.addOption(maxLoadOption);
+
+    QCommandLineOption handshakeTimeoutOption("handshake-timeout",
+                                              "Milliseconds a new connection has to complete "
+                                              "its TLS handshake (default: 10000)",
+                                              "ms",
+                                              "10000");
+    parser.addOption(handshakeTimeoutOption);
+
+    QCommandLineOption tlsCiphersOption("tls-ciphers",
+                                        "Colon-separated OpenSSL cipher names in order of "
+                                        "preference (default: Qt's list)",
+                                        "ciphers");
+    parser.addOption(tlsCiphersOption);
+
+    QCommandLineOption sessionLifetimeOption("session-lifetime",
+                                             "Seconds after LOGIN during which a reconnecting "
+                                             "client may resume its session instead, 0 to "
+                                             "disable (default: 43200). Servers share sessions "
+                                             "when QLMS_SESSION_SECRET is set.",
+                                             "seconds",
+                                             "43200");
+    parser.addOption(sessionLifetimeOption);
+
     parser.process(app);
 
+    ConnectionPoolOptions poolOptions;
+    poolOptions.host = parser.value(dbHostOption);
+    poolOptions.port = parser.value(dbPortOption).toInt();
+    poolOptions.databaseName = parser.value(dbNameOption);
+    poolOptions.username = parser.value(dbUserOption);
+    poolOptions.password = parser.value(dbPassOption);
+    poolOptions.minConnections = parser.value(poolMinOption).toInt();
+    poolOptions.maxConnections = parser.value(poolMaxOption).toInt();
+    poolOptions.acquireTimeoutMs = parser.value(poolTimeoutOption).toInt();
+
     // Initialize database
-    if (!DatabaseManager::instance().initialize(parser.value(dbHostOption),
-                                                parser.value(dbPortOption).toInt(),
-                                                parser.value(dbNameOption),
-                                                parser.value(dbUserOption),
-                                                parser.value(dbPassOption))) {
+    if (!DatabaseManager::instance().initialize(poolOptions)) {
         qCritical() << "Failed to initialize database connection";
         return 1;
     }
 
+    // Without it clients still work, they just don't get pushed updates
+    if (!NotificationHub::instance().start(poolOptions)) {
+        qWarning() << "Change notifications are disabled";
+    }
+
+    int bulkConnections = parser.value(bulkConnectionsOption).toInt();
+    DatabaseManager::instance().setSchedulerLimits(parser.value(criticalReserveOption).toInt(),
+                                                   bulkConnections > 0
+                                                       ? bulkConnections
+                                                       : poolOptions.maxConnections / 4);
+
+    qint64 quizCacheBytes = parser.value(quizCacheSizeOption).toLongLong() * 1024 * 1024;
+    DatabaseManager::instance().setQuizCacheLimits(parser.value(quizCacheEntriesOption).toInt(),
+                                                   quizCacheBytes);
+
+    int maxLoad = parser.value(maxLoadOption).toInt();
+    AdmissionController::instance().configure(maxLoad > 0 ? maxLoad
+                                                          : 4 * poolOptions.maxConnections);
+
+    // Without a shared secret, tokens only work with the process that issued them
+    SessionTokens::instance().configure(qgetenv("QLMS_SESSION_SECRET"),
+                                        parser.value(sessionLifetimeOption).toInt());
+
+    ServerOptions serverOptions;
+    serverOptions.eventLoopThreads = parser.value(threadsOption).toInt();
+    serverOptions.statsIntervalSec = parser.value(statsIntervalOption).toInt();
+    serverOptions.maxMessageSize = parser.value(maxMessageSizeOption).toLongLong();
+    serverOptions.maxPipelinedCommands = parser.value(maxPipelinedOption).toInt();
+    serverOptions.compressionThreshold = parser.value(compressionThresholdOption).toLongLong();
+    serverOptions.outputHighWater = parser.value(outputHighWaterOption).toLongLong();
+    serverOptions.outputLowWater = serverOptions.outputHighWater / 4;
+    serverOptions.maxQueuedCommands = parser.value(maxQueuedOption).toInt();
+    serverOptions.maxQueuedBytes = parser.value(maxQueuedBytesOption).toLongLong();
+    serverOptions.interactiveRate = parser.value(interactiveRateOption).toDouble();
+    serverOptions.bulkRate = parser.value(bulkRateOption).toDouble();
+    serverOptions.handshakeTimeoutMs = parser.value(handshakeTimeoutOption).toInt();
+    serverOptions.tlsCiphers = parser.value(tlsCiphersOption);
+
     // Start server
-    Server server;
+    Server server(serverOptions);
     if (!server.start(parser.value(portOption).toUShort())) {
         return 1;
     }
@@ -0,0 +1,135 @@
+#include "notificationhub.h"
+#include "clienthandler.h"
+#include "databasemanager.h"
+#include <QDebug>
+#include <QJsonDocument>
+#include <QSqlError>
+
+NotificationHub &NotificationHub::instance()
+{
+    static NotificationHub instance;
+    return instance;
+}
+
+NotificationHub::NotificationHub() {}
+
+NotificationHub::~NotificationHub()
+{
+    stop();
+}
+
+bool NotificationHub::start(const ConnectionPoolOptions &options)
+{
+    // Not part of the pool: a listening session has to stay open on the thread that owns it
+    m_db = QSqlDatabase::addDatabase("QPSQL", "QLMSNotifications");
+    m_db.setHostName(options.host);
+    m_db.setPort(options.port);
+    m_db.setDatabaseName(options.databaseName);
+    m_db.setUserName(options.username);
+    m_db.setPassword(options.password);
+
+    if (!m_db.open()) {
+        qWarning() << "Failed to open notification connection:" << m_db.lastError().text();
+        return false;
+    }
+
+    if (!m_db.driver()->subscribeToNotification(DatabaseManager::NotificationChannel)) {
+        qWarning() << "Failed to listen for database notifications:"
+                   << m_db.driver()->lastError().text();
+        m_db.close();
+        return false;
+    }
+
+    connect(m_db.driver(), &QSqlDriver::notification, this, &NotificationHub::onNotification);
+    qInfo() << "Listening for change notifications on" << DatabaseManager::NotificationChannel;
+    return true;
+}
+
+void NotificationHub::stop()
+{
+    if (!m_db.isValid())
+        return;
+
+    m_db.close();
+    m_db = QSqlDatabase();
+    QSqlDatabase::removeDatabase("QLMSNotifications");
+}
+
+void NotificationHub::subscribe(ClientHandler *handler, const QString &topic, const QString &alias)
+{
+    QMutexLocker locker(&m_mutex);
+    m_subscribers[topic].insert(handler, alias);
+}
+
+void NotificationHub::unsubscribe(ClientHandler *handler, const QString &topic)
+{
+    QMutexLocker locker(&m_mutex);
+    auto it = m_subscribers.find(topic);
+    if (it == m_subscribers.end())
+        return;
+
+    it->remove(handler);
+    if (it->isEmpty()) {
+        m_subscribers.erase(it);
+    }
+}
+
+void NotificationHub::unsubscribeAll(ClientHandler *handler)
+{
+    QMutexLocker locker(&m_mutex);
+    for (auto it = m_subscribers.begin(); it != m_subscribers.end();) {
+        it->remove(handler);
+        it = it->isEmpty() ? m_subscribers.erase(it) : std::next(it);
+    }
+}
+
+QJsonObject NotificationHub::statistics() const
+{
+    QMutexLocker locker(&m_mutex);
+    qsizetype subscriptions = 0;
+    for (const auto &handlers : m_subscribers) {
+        subscriptions += handlers.size();
+    }
+
+    QJsonObject stats;
+    stats["topics"] = m_subscribers.size();
+    stats["subscriptions"] = subscriptions;
+    stats["events"] = static_cast<double>(m_received);
+    stats["deliveries"] = static_cast<double>(m_deliveries);
+    return stats;
+}
+
+void NotificationHub::onNotification(const QString &name,
+                                     QSqlDriver::NotificationSource,
+                                     const QVariant &payload)
+{
+    if (name != QLatin1String(DatabaseManager::NotificationChannel))
+        return;
+
+    QJsonObject message = QJsonDocument::fromJson(payload.toString().toUtf8()).object();
+    QString topic = message["topic"].toString();
+    if (topic.isEmpty()) {
+        qWarning() << "Ignoring malformed change notification:" << payload.toString();
+        return;
+    }
+    publish(topic, message["event"].toObject());
+}
+
+void NotificationHub::publish(const QString &topic, const QJsonObject &event)
+{
+    // Handlers unsubscribe under the mutex before they are deleted, so every handler seen here
+    // is alive while its event is posted
+    QMutexLocker locker(&m_mutex);
+    ++m_received;
+
+    const QHash<ClientHandler *, QString> handlers = m_subscribers.value(topic);
+    for (auto it = handlers.cbegin(); it != handlers.cend(); ++it) {
+        ClientHandler *handler = it.key();
+        QString alias = it.value();
+        QMetaObject::invokeMethod(
+            handler,
+            [handler, alias, event]() { handler->pushEvent(alias, event); },
+            Qt::QueuedConnection);
+        ++m_deliveries;
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef NOTIFICATIONHUB_H
+#define NOTIFICATIONHUB_H
+
+#include "connectionpool.h"
+#include <QHash>
+#include <QJsonObject>
+#include <QMutex>
+#include <QObject>
+#include <QSqlDatabase>
+#include <QSqlDriver>
+
+class ClientHandler;
+
+// Fans out change events to subscribed clients. Writers publish with pg_notify() inside their
+// transaction (see DatabaseManager::notify), so an event goes out only once its change is
+// committed. The hub LISTENs on a dedicated connection owned by the main thread and hands each
+// event to the event loops of the subscribed handlers.
+class NotificationHub : public QObject
+{
+    Q_OBJECT
+
+public:
+    static NotificationHub &instance();
+
+    bool start(const ConnectionPoolOptions &options);
+    void stop();
+
+    // Thread-safe. topic is the server-side key (e.g. "grades:42"); events are delivered to the
+    // handler under alias, the name the client subscribed with.
+    void subscribe(ClientHandler *handler, const QString &topic, const QString &alias);
+    void unsubscribe(ClientHandler *handler, const QString &topic);
+    void unsubscribeAll(ClientHandler *handler);
+
+    QJsonObject statistics() const;
+
+private slots:
+    void onNotification(const QString &name,
+                        QSqlDriver::NotificationSource source,
+                        const QVariant &payload);
+
+private:
+    NotificationHub();
+    ~NotificationHub();
+    NotificationHub(const NotificationHub &) = delete;
+    NotificationHub &operator=(const NotificationHub &) = delete;
+
+    void publish(const QString &topic, const QJsonObject &event);
+
+    QSqlDatabase m_db;
+    mutable QMutex m_mutex;
+    QHash<QString, QHash<ClientHandler *, QString>> m_subscribers; // topic -> handler -> alias
+    quint64 m_received = 0;
+    quint64 m_deliveries = 0;
+};
+
+#endif // NOTIFICATIONHUB_H
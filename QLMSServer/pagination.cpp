@@ -0,0 +1,40 @@
+#include "pagination.h"
+#include <QByteArray>
+#include <QJsonDocument>
+
+bool PageRequest::fromJson(const QJsonObject &data, int keySize, PageRequest *page)
+{
+    page->limit = qBound(1, data["limit"].toInt(DefaultLimit), MaxLimit);
+    page->after = QJsonArray();
+
+    QString cursor = data["cursor"].toString();
+    if (cursor.isEmpty()) {
+        return true;
+    }
+
+    auto decoded = QByteArray::fromBase64Encoding(cursor.toLatin1(),
+                                                  QByteArray::Base64UrlEncoding
+                                                      | QByteArray::AbortOnBase64DecodingErrors);
+    if (!decoded) {
+        return false;
+    }
+
+    QJsonDocument doc = QJsonDocument::fromJson(*decoded);
+    if (!doc.isArray() || doc.array().size() != keySize) {
+        return false;
+    }
+    for (const QJsonValue &key : doc.array()) {
+        if (!key.isString() && !key.isDouble()) {
+            return false;
+        }
+    }
+    page->after = doc.array();
+    return true;
+}
+
+QString PageRequest::encodeCursor(const QJsonArray &key)
+{
+    QByteArray json = QJsonDocument(key).toJson(QJsonDocument::Compact);
+    return QString::fromLatin1(
+        json.toBase64(QByteArray::Base64UrlEncoding | QByteArray::OmitTrailingEquals));
+}
@@ -0,0 +1,26 @@
+#ifndef PAGINATION_H
+#define PAGINATION_H
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QString>
+
+// Keyset pagination for list commands. A page continues after the sort key of the last row the
+// client has already received, so later pages cost the same as the first and rows inserted or
+// removed in between don't shift the pages. The key travels as an opaque base64url cursor.
+struct PageRequest
+{
+    static constexpr int DefaultLimit = 100;
+    static constexpr int MaxLimit = 500;
+
+    int limit = DefaultLimit;
+    QJsonArray after; // Sort key of the last row already returned; empty for the first page
+
+    // Reads the optional "limit" and "cursor" fields. Returns false for a cursor that is malformed
+    // or doesn't hold keySize keys, which the command must reject rather than restart the list.
+    static bool fromJson(const QJsonObject &data, int keySize, PageRequest *page);
+
+    static QString encodeCursor(const QJsonArray &key);
+};
+
+#endif // PAGINATION_H
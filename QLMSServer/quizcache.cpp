@@ -0,0 +1,122 @@
+#include "quizcache.h"
+#include "coursematerial.h"
+#include <QJsonDocument>
+
+QuizCache::QuizCache(int maxEntries, qint64 maxBytes)
+    : m_maxEntries(maxEntries)
+    , m_maxBytes(maxBytes)
+{}
+
+void QuizCache::setLimits(int maxEntries, qint64 maxBytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maxEntries = qMax(0, maxEntries);
+    m_maxBytes = qMax<qint64>(0, maxBytes);
+    evict();
+}
+
+std::shared_ptr<const Quiz> QuizCache::getOrLoad(int quizId, const Loader &loader)
+{
+    QMutexLocker locker(&m_mutex);
+
+    // Another thread is already building this quiz; wait for it instead of hitting Postgres too
+    while (m_loading.contains(quizId)) {
+        m_loadFinished.wait(&m_mutex);
+    }
+
+    auto it = m_entries.find(quizId);
+    if (it != m_entries.end()) {
+        ++m_hits;
+        m_lru.splice(m_lru.begin(), m_lru, it->position);
+        return it->quiz;
+    }
+
+    ++m_misses;
+    m_loading.insert(quizId);
+    locker.unlock();
+
+    std::shared_ptr<const Quiz> quiz = loader();
+
+    locker.relock();
+    m_loading.remove(quizId);
+
+    // A write that landed while we were loading may have made this copy stale
+    if (quiz && !m_invalidatedWhileLoading.remove(quizId)) {
+        insert(quizId, quiz);
+    }
+    m_loadFinished.wakeAll();
+    return quiz;
+}
+
+void QuizCache::remove(int quizId)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_loading.contains(quizId)) {
+        m_invalidatedWhileLoading.insert(quizId);
+    }
+
+    auto it = m_entries.find(quizId);
+    if (it != m_entries.end()) {
+        m_bytes -= it->bytes;
+        m_lru.erase(it->position);
+        m_entries.erase(it);
+    }
+}
+
+void QuizCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_invalidatedWhileLoading = m_loading;
+    m_entries.clear();
+    m_lru.clear();
+    m_bytes = 0;
+}
+
+QJsonObject QuizCache::statistics() const
+{
+    QMutexLocker locker(&m_mutex);
+    quint64 lookups = m_hits + m_misses;
+
+    QJsonObject stats;
+    stats["entries"] = m_entries.size();
+    stats["bytes"] = static_cast<double>(m_bytes);
+    stats["max_entries"] = m_maxEntries;
+    stats["max_bytes"] = static_cast<double>(m_maxBytes);
+    stats["hits"] = static_cast<double>(m_hits);
+    stats["misses"] = static_cast<double>(m_misses);
+    stats["evictions"] = static_cast<double>(m_evictions);
+    stats["hit_rate"] = lookups > 0 ? static_cast<double>(m_hits) / lookups : 0.0;
+    return stats;
+}
+
+void QuizCache::insert(int quizId, std::shared_ptr<const Quiz> quiz)
+{
+    // Called with m_mutex held
+    qint64 bytes = estimateSize(*quiz);
+    if (bytes > m_maxBytes || m_maxEntries == 0) {
+        return;
+    }
+
+    m_lru.push_front(quizId);
+    m_entries.insert(quizId, {std::move(quiz), bytes, m_lru.begin()});
+    m_bytes += bytes;
+    evict();
+}
+
+void QuizCache::evict()
+{
+    // Called with m_mutex held
+    while (!m_lru.empty() && (m_entries.size() > m_maxEntries || m_bytes > m_maxBytes)) {
+        auto it = m_entries.find(m_lru.back());
+        m_bytes -= it->bytes;
+        m_entries.erase(it);
+        m_lru.pop_back();
+        ++m_evictions;
+    }
+}
+
+qint64 QuizCache::estimateSize(const Quiz &quiz)
+{
+    // The serialized form tracks the strings that dominate a quiz's footprint closely enough
+    return QJsonDocument(quiz.toJson(true)).toJson(QJsonDocument::Compact).size() * 2;
+}
@@ -0,0 +1,60 @@
+#ifndef QUIZCACHE_H
+#define QUIZCACHE_H
+
+#include <functional>
+#include <list>
+#include <memory>
+#include <QHash>
+#include <QJsonObject>
+#include <QMutex>
+#include <QSet>
+#include <QWaitCondition>
+
+class Quiz;
+
+// Server-wide LRU cache of immutable quiz definitions keyed by material_id, bounded both by
+// entry count and by approximate memory. Concurrent misses for one quiz share a single load.
+class QuizCache
+{
+public:
+    using Loader = std::function<std::shared_ptr<const Quiz>()>;
+
+    QuizCache(int maxEntries = 256, qint64 maxBytes = 64 * 1024 * 1024);
+
+    void setLimits(int maxEntries, qint64 maxBytes);
+
+    // Returns the cached quiz or runs loader (once, even if several threads miss together)
+    std::shared_ptr<const Quiz> getOrLoad(int quizId, const Loader &loader);
+
+    void remove(int quizId);
+    void clear();
+
+    QJsonObject statistics() const;
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<const Quiz> quiz;
+        qint64 bytes;
+        std::list<int>::iterator position;
+    };
+
+    void insert(int quizId, std::shared_ptr<const Quiz> quiz);
+    void evict();
+    static qint64 estimateSize(const Quiz &quiz);
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_loadFinished;
+    QHash<int, Entry> m_entries;
+    std::list<int> m_lru; // Most recently used at the front
+    QSet<int> m_loading;
+    QSet<int> m_invalidatedWhileLoading;
+    int m_maxEntries;
+    qint64 m_maxBytes;
+    qint64 m_bytes = 0;
+    quint64 m_hits = 0;
+    quint64 m_misses = 0;
+    quint64 m_evictions = 0;
+};
+
+#endif // QUIZCACHE_H
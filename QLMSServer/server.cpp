@@ -1,17 +1,52 @@
 #include "server.h"
+#include "admissioncontroller.h"
 #include "clienthandler.h"
+#include "databasemanager.h"
+#include "eventlooppool.h"
+#include "messagecodec.h"
+#include "notificationhub.h"
+#include "sessiontokens.h"
+#include <memory>
 #include <QDateTime>
 #include <QDebug>
 #include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
 #include <QSslConfiguration>
 #include <QSslKey>
 #include <QSslSocket>
+#include <QTcpServer>
 #include <QThread>
+#include <QTimer>
 
-Server::Server(QObject *parent)
+// Accepts plain TCP connections and leaves the TLS handshake to the client event loops
+class TcpListener : public QTcpServer
+{
+public:
+    explicit TcpListener(Server *server)
+        : QTcpServer(server)
+        , m_server(server)
+    {}
+
+protected:
+    void incomingConnection(qintptr descriptor) override
+    {
+        m_server->acceptConnection(descriptor);
+    }
+
+private:
+    Server *m_server;
+};
+
+Server::Server(const ServerOptions &options, QObject *parent)
     : QObject(parent)
-    , m_tcpServer(new QSslServer(this))
+    , m_options(options)
+    , m_tcpServer(new TcpListener(this))
+    , m_eventLoops(new EventLoopPool(options.eventLoopThreads, this))
+    , m_statsTimer(new QTimer(this))
 {
+    connect(m_statsTimer, &QTimer::timeout, this, &Server::logStatistics);
+
     // Load SSL certificate and key
     QFile certFile("server.crt");
     QFile keyFile("server.key");
@@ -30,8 +65,11 @@ Server::Server(QObject *parent)
         return;
     }
 
+    // The key type follows the certificate. ECDSA (P-256) keys make handshakes much cheaper
+    // for the server than RSA ones.
     QSslCertificate certificate(&certFile, QSsl::Pem);
-    QSslKey privateKey(&keyFile, QSsl::Rsa, QSsl::Pem, QSsl::PrivateKey);
+    QSsl::KeyAlgorithm keyAlgorithm = certificate.publicKey().algorithm();
+    QSslKey privateKey(&keyFile, keyAlgorithm, QSsl::Pem, QSsl::PrivateKey);
     certFile.close();
     keyFile.close();
 
@@ -50,42 +88,19 @@ Server::Server(QObject *parent)
     sslConfig.setPrivateKey(privateKey);
     sslConfig.setPeerVerifyMode(QSslSocket::VerifyNone); // Accept any client
     sslConfig.setProtocol(QSsl::TlsV1_2OrLater);
+    if (!m_options.tlsCiphers.isEmpty()) {
+        // Clients get the first cipher on the list that they support
+        sslConfig.setCiphers(m_options.tlsCiphers);
+        if (sslConfig.ciphers().isEmpty()) {
+            qCritical() << "None of the TLS ciphers" << m_options.tlsCiphers << "is supported";
+            return;
+        }
+    }
 
-    m_tcpServer->setSslConfiguration(sslConfig);
-
-    qInfo() << "SSL certificate and key loaded successfully";
-
-    // Connect to handle SSL errors from the server
-    connect(m_tcpServer,
-            &QSslServer::errorOccurred,
-            this,
-            [this](QSslSocket *socket, QAbstractSocket::SocketError error) {
-                if (socket) {
-                    qWarning() << "QSslServer error for socket from"
-                               << socket->peerAddress().toString() << ":" << error << "-"
-                               << socket->errorString();
-                } else {
-                    qWarning() << "QSslServer error:" << error;
-                }
-            });
-
-    // Connect to handle SSL errors during handshake
-    connect(m_tcpServer,
-            &QSslServer::sslErrors,
-            this,
-            [this](QSslSocket *socket, const QList<QSslError> &errors) {
-                qWarning() << "SSL errors on incoming connection:";
-                for (const QSslError &error : errors) {
-                    qWarning() << "  -" << error.errorString();
-                }
-                // Accept self-signed certificates
-                if (socket) {
-                    socket->ignoreSslErrors();
-                }
-            });
+    m_sslConfiguration = sslConfig;
 
-    // Connect to handle new connections
-    connect(m_tcpServer, &QSslServer::pendingConnectionAvailable, this, &Server::onNewConnection);
+    qInfo() << "SSL certificate and key loaded successfully, key type:"
+            << (keyAlgorithm == QSsl::Ec ? "ECDSA" : keyAlgorithm == QSsl::Rsa ? "RSA" : "other");
 }
 
 Server::~Server()
@@ -95,11 +110,21 @@ Server::~Server()
 
 bool Server::start(quint16 port)
 {
+    if (m_sslConfiguration.privateKey().isNull()) {
+        qCritical() << "Cannot start without a usable SSL certificate and key";
+        return false;
+    }
+
     if (!m_tcpServer->listen(QHostAddress::Any, port)) {
         qCritical() << "Failed to start server:" << m_tcpServer->errorString();
         return false;
     }
 
+    m_eventLoops->start();
+    if (m_options.statsIntervalSec > 0) {
+        m_statsTimer->start(m_options.statsIntervalSec * 1000);
+    }
+
     qInfo() << "Server started on port" << port << "(SSL enabled)";
     qInfo() << "Server listening on" << m_tcpServer->serverAddress().toString() << ":"
             << m_tcpServer->serverPort();
@@ -109,30 +134,102 @@ bool Server::start(quint16 port)
 void Server::stop()
 {
     m_tcpServer->close();
+    m_statsTimer->stop();
+    m_eventLoops->stop();
+
     m_clients.clear();
+    m_clientLoops.clear();
     qInfo() << "Server stopped";
 }
 
-void Server::onNewConnection()
+void Server::acceptConnection(qintptr descriptor)
 {
-    qDebug() << "New connection available";
+    QThread *loop = m_eventLoops->assign();
+    ++m_handshakesStarted;
+    QElapsedTimer accepted;
+    accepted.start();
+
+    // The socket adopts the descriptor on its event loop, so the handshake runs there instead
+    // of on this thread
+    auto *socket = new QSslSocket();
+    socket->moveToThread(loop);
+    QMetaObject::invokeMethod(
+        socket,
+        [this, socket, descriptor, loop, accepted]() {
+            startHandshake(socket, descriptor, loop, accepted);
+        },
+        Qt::QueuedConnection);
+}
 
-    // Get the pending connection as QSslSocket
-    QSslSocket *socket = qobject_cast<QSslSocket *>(m_tcpServer->nextPendingConnection());
+void Server::startHandshake(QSslSocket *socket,
+                            qintptr descriptor,
+                            QThread *loop,
+                            QElapsedTimer accepted)
+{
+    // Whichever comes first of success, error, disconnect or timeout decides the handshake
+    auto decided = std::make_shared<bool>(false);
+    auto fail = [this, socket, loop, decided](const QString &reason) {
+        if (*decided)
+            return;
+        *decided = true;
+        qWarning() << "TLS handshake with" << socket->peerAddress().toString()
+                   << "failed:" << reason;
+        socket->abort();
+        socket->deleteLater();
+        QMetaObject::invokeMethod(
+            this,
+            [this, loop]() {
+                ++m_handshakesFailed;
+                m_eventLoops->release(loop);
+            },
+            Qt::QueuedConnection);
+    };
 
-    if (!socket) {
-        qWarning() << "Failed to get SSL socket from pending connection";
+    if (!socket->setSocketDescriptor(descriptor)) {
+        fail(socket->errorString());
         return;
     }
+    socket->setSslConfiguration(m_sslConfiguration);
+
+    connect(socket, &QSslSocket::sslErrors, socket, [socket](const QList<QSslError> &errors) {
+        qWarning() << "SSL errors on incoming connection:";
+        for (const QSslError &error : errors) {
+            qWarning() << "  -" << error.errorString();
+        }
+        // Accept self-signed certificates
+        socket->ignoreSslErrors();
+    });
+    connect(socket, &QSslSocket::errorOccurred, socket, [socket, fail]() {
+        fail(socket->errorString());
+    });
+    connect(socket, &QSslSocket::disconnected, socket, [fail]() {
+        fail("peer disconnected");
+    });
+    QTimer::singleShot(m_options.handshakeTimeoutMs, socket, [fail]() {
+        fail("timed out");
+    });
+    connect(socket, &QSslSocket::encrypted, socket, [this, socket, loop, accepted, decided]() {
+        if (*decided)
+            return;
+        *decided = true;
+        // The handshake handlers are done; the client handler installs its own
+        socket->disconnect(socket);
+        handleEncryptedSocket(socket, loop, accepted.nsecsElapsed());
+    });
+
+    socket->startServerEncryption();
+}
 
+void Server::handleEncryptedSocket(QSslSocket *socket, QThread *loop, qint64 handshakeNs)
+{
     qInfo() << "New SSL connection from" << socket->peerAddress().toString() << ":"
             << socket->peerPort() << "(encrypted)";
 
     // Connect error handler for this specific socket
     connect(socket,
             &QSslSocket::errorOccurred,
-            this,
-            [this, socket](QAbstractSocket::SocketError error) {
+            socket,
+            [socket](QAbstractSocket::SocketError error) {
                 // Only log non-standard disconnection errors
                 if (error != QAbstractSocket::RemoteHostClosedError) {
                     qWarning() << "Socket error from" << socket->peerAddress().toString() << ":"
@@ -140,45 +237,32 @@ void Server::onNewConnection()
                 }
             });
 
-    // With QSslServer, the socket is already encrypted, so we can directly set up the handler
-    handleEncryptedSocket(socket);
-}
-
-void Server::handleEncryptedSocket(QSslSocket *socket)
-{
-    qDebug() << "Setting up ClientHandler for encrypted socket from"
-             << socket->peerAddress().toString();
-
-    // Create thread and handler
-    QThread *thread = new QThread();
-    ClientHandler *handler = new ClientHandler(socket);
-
-    // Move the worker to the new thread
-    handler->moveToThread(thread);
-
-    // The socket must also live in the new thread
-    socket->setParent(nullptr);
-    socket->moveToThread(thread);
-
-    // When the thread starts, tell the worker to start processing
-    connect(thread, &QThread::started, handler, &ClientHandler::startProcessing);
+    // Created on the loop it will run on
+    ClientHandler *handler = new ClientHandler(socket, m_options);
 
     // Forward signals from the worker back to the server in the main thread
     connect(handler, &ClientHandler::logMessage, this, &Server::onLogMessage);
     connect(handler, &ClientHandler::clientDisconnected, this, &Server::onClientDisconnected);
 
-    // When the thread finishes, clean up everything
-    connect(thread, &QThread::finished, handler, &QObject::deleteLater);
-    connect(thread, &QThread::finished, socket, &QObject::deleteLater);
-    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    // Queued ahead of any clientDisconnected() the handler may emit
+    QMetaObject::invokeMethod(
+        this,
+        [this, handler, loop, handshakeNs]() {
+            m_clients.append(handler);
+            m_clientLoops.insert(handler, loop);
+            ++m_handshakesCompleted;
+            m_handshakeNsTotal += handshakeNs;
+            m_handshakeNsMax = qMax(m_handshakeNsMax, handshakeNs);
+        },
+        Qt::QueuedConnection);
 
-    m_clients.append(handler);
-    thread->start();
+    handler->startProcessing();
 }
 
 void Server::onClientDisconnected(ClientHandler *handler)
 {
     m_clients.removeAll(handler);
+    m_eventLoops->release(m_clientLoops.take(handler));
     qInfo() << "Client handler removed, active clients:" << m_clients.size();
 }
 
@@ -187,3 +271,39 @@ void Server::onLogMessage(const QString &message)
     QString timestamp = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
     qInfo() << QString("[%1] %2").arg(timestamp, message);
 }
+
+QJsonObject Server::statistics() const
+{
+    QJsonArray loops;
+    for (int connections : m_eventLoops->connectionCounts()) {
+        loops.append(connections);
+    }
+
+    QJsonObject handshakes;
+    handshakes["started"] = static_cast<double>(m_handshakesStarted);
+    handshakes["completed"] = static_cast<double>(m_handshakesCompleted);
+    handshakes["failed"] = static_cast<double>(m_handshakesFailed);
+    handshakes["in_progress"] = static_cast<double>(m_handshakesStarted - m_handshakesCompleted
+                                                    - m_handshakesFailed);
+    handshakes["avg_ms"] = m_handshakesCompleted > 0
+                               ? m_handshakeNsTotal / 1e6 / m_handshakesCompleted
+                               : 0.0;
+    handshakes["max_ms"] = m_handshakeNsMax / 1e6;
+
+    QJsonObject stats;
+    stats["clients"] = m_clients.size();
+    stats["connections_per_loop"] = loops;
+    stats["tls_handshakes"] = handshakes;
+    stats["compression"] = MessageCodec::statistics();
+    stats["database"] = DatabaseManager::instance().statistics();
+    stats["notifications"] = NotificationHub::instance().statistics();
+    stats["session_tokens"] = SessionTokens::instance().statistics();
+    stats["admission"] = AdmissionController::instance().statistics();
+    return stats;
+}
+
+void Server::logStatistics()
+{
+    qInfo().noquote() << "Server statistics:"
+                      << QJsonDocument(statistics()).toJson(QJsonDocument::Compact);
+}
@@ -1,35 +1,66 @@
 #ifndef SERVER_H
 #define SERVER_H
 
+#include "serveroptions.h"
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
 #include <QList>
 #include <QObject>
-#include <QSslServer>
+#include <QSslConfiguration>
 
 class ClientHandler;
+class EventLoopPool;
 class QSslSocket;
+class QTcpServer;
+class QThread;
+class QTimer;
 
 class Server : public QObject
 {
     Q_OBJECT
 
 public:
-    explicit Server(QObject *parent = nullptr);
+    explicit Server(const ServerOptions &options = ServerOptions(), QObject *parent = nullptr);
     ~Server();
 
     bool start(quint16 port);
     void stop();
 
+    QJsonObject statistics() const;
+
 private slots:
-    void onNewConnection();
     void onClientDisconnected(ClientHandler *handler);
     void onLogMessage(const QString &message);
+    void logStatistics();
 
 private:
-    void handleEncryptedSocket(QSslSocket *socket);
+    friend class TcpListener;
+
+    // Called on the main thread for each accepted connection
+    void acceptConnection(qintptr descriptor);
+    // These run on the client's event loop
+    void startHandshake(QSslSocket *socket,
+                        qintptr descriptor,
+                        QThread *loop,
+                        QElapsedTimer accepted);
+    void handleEncryptedSocket(QSslSocket *socket, QThread *loop, qint64 handshakeNs);
 
 private:
-    QSslServer *m_tcpServer;
+    ServerOptions m_options;
+    QTcpServer *m_tcpServer;
+    QSslConfiguration m_sslConfiguration; // Only read once the server has started
+    EventLoopPool *m_eventLoops;
+    QTimer *m_statsTimer;
     QList<ClientHandler *> m_clients;
+    QHash<ClientHandler *, QThread *> m_clientLoops;
+
+    // TLS handshake metrics, timed from accept() to the encrypted connection
+    quint64 m_handshakesStarted = 0;
+    quint64 m_handshakesCompleted = 0;
+    quint64 m_handshakesFailed = 0;
+    qint64 m_handshakeNsTotal = 0;
+    qint64 m_handshakeNsMax = 0;
 };
 
 #endif // SERVER_H
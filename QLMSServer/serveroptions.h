@@ -0,0 +1,24 @@
+#ifndef SERVEROPTIONS_H
+#define SERVEROPTIONS_H
+
+#include <QString>
+#include <QtGlobal>
+
+struct ServerOptions
+{
+    int eventLoopThreads = 0;                    // 0 means one per CPU core
+    int statsIntervalSec = 60;                   // 0 disables the periodic statistics log
+    qsizetype maxMessageSize = 16 * 1024 * 1024; // Larger requests close the connection
+    int maxPipelinedCommands = 8;                // Commands with a request_id run concurrently
+    qsizetype compressionThreshold = 4096;       // Smallest compressed response, 0 disables
+    qsizetype outputHighWater = 1024 * 1024;     // Unsent output at which a client's reads pause
+    qsizetype outputLowWater = 256 * 1024;       // Unsent output at which they resume
+    int handshakeTimeoutMs = 10000;              // Connections not encrypted by then are dropped
+    int maxQueuedCommands = 64;                  // Waiting requests at which a client's reads pause
+    qsizetype maxQueuedBytes = 4 * 1024 * 1024;  // Undecoded request bytes at which they pause too
+    double interactiveRate = 50;                 // Interactive commands per second, 0 = unlimited
+    double bulkRate = 5;                         // Bulk commands per second, 0 = unlimited
+    QString tlsCiphers; // OpenSSL cipher names, colon separated, most preferred first
+};
+
+#endif // SERVEROPTIONS_H
@@ -0,0 +1,140 @@
+#include "sessiontokens.h"
+#include "user.h"
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QMessageAuthenticationCode>
+#include <QRandomGenerator>
+
+static constexpr auto TokenEncoding = QByteArray::Base64UrlEncoding
+                                      | QByteArray::OmitTrailingEquals;
+
+SessionTokens &SessionTokens::instance()
+{
+    static SessionTokens instance;
+    return instance;
+}
+
+SessionTokens::SessionTokens() {}
+
+void SessionTokens::configure(const QByteArray &secret, int lifetimeSec)
+{
+    QMutexLocker locker(&m_mutex);
+    m_secret = secret;
+    if (m_secret.isEmpty()) {
+        m_secret.resize(32);
+        QRandomGenerator::system()->generate(m_secret.begin(), m_secret.end());
+    }
+    m_lifetimeSec = qMax(0, lifetimeSec);
+}
+
+bool SessionTokens::isEnabled() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_lifetimeSec > 0;
+}
+
+QString SessionTokens::issue(const User &user, qint64 loggedInAt)
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (loggedInAt <= 0) {
+        loggedInAt = now;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    QJsonObject claims;
+    claims["uid"] = user.getId();
+    claims["name"] = user.getUsername();
+    claims["role"] = user.getRole();
+    claims["iat"] = now;
+    claims["auth"] = loggedInAt;
+    claims["exp"] = loggedInAt + qint64(m_lifetimeSec) * 1000;
+
+    QByteArray payload = QJsonDocument(claims).toJson(QJsonDocument::Compact);
+    ++m_issued;
+    return QString::fromLatin1(payload.toBase64(TokenEncoding) + '.'
+                               + sign(payload).toBase64(TokenEncoding));
+}
+
+std::shared_ptr<User> SessionTokens::verify(const QString &token, qint64 *loggedInAt)
+{
+    QMutexLocker locker(&m_mutex);
+    auto reject = [this]() {
+        ++m_rejected;
+        return std::shared_ptr<User>();
+    };
+
+    QList<QByteArray> parts = token.toLatin1().split('.');
+    if (m_lifetimeSec <= 0 || parts.size() != 2) {
+        return reject();
+    }
+
+    auto options = TokenEncoding | QByteArray::AbortOnBase64DecodingErrors;
+    auto payload = QByteArray::fromBase64Encoding(parts[0], options);
+    auto signature = QByteArray::fromBase64Encoding(parts[1], options);
+    if (!payload || !signature) {
+        return reject();
+    }
+
+    // Compare in constant time so the signature can't be guessed byte by byte
+    QByteArray expected = sign(*payload);
+    if (signature->size() != expected.size()) {
+        return reject();
+    }
+    char difference = 0;
+    for (qsizetype i = 0; i < expected.size(); ++i) {
+        difference |= expected[i] ^ signature->at(i);
+    }
+    if (difference != 0) {
+        return reject();
+    }
+
+    QJsonObject claims = QJsonDocument::fromJson(*payload).object();
+    int userId = claims["uid"].toInt();
+    qint64 issuedAt = claims["iat"].toInteger();
+    if (claims["exp"].toInteger() <= QDateTime::currentMSecsSinceEpoch()
+        || issuedAt < m_revokedBefore.value(userId)) {
+        return reject();
+    }
+
+    QString username = claims["name"].toString();
+    QString role = claims["role"].toString();
+    std::shared_ptr<User> user;
+    if (role == "admin") {
+        user = std::make_shared<Admin>(userId, username);
+    } else if (role == "instructor") {
+        user = std::make_shared<Instructor>(userId, username);
+    } else if (role == "student") {
+        user = std::make_shared<Student>(userId, username);
+    } else {
+        return reject();
+    }
+
+    if (loggedInAt) {
+        *loggedInAt = claims["auth"].toInteger(issuedAt);
+    }
+    ++m_accepted;
+    return user;
+}
+
+void SessionTokens::revokeUser(int userId)
+{
+    QMutexLocker locker(&m_mutex);
+    // Covers tokens issued within the same millisecond
+    m_revokedBefore.insert(userId, QDateTime::currentMSecsSinceEpoch() + 1);
+}
+
+QJsonObject SessionTokens::statistics() const
+{
+    QMutexLocker locker(&m_mutex);
+    QJsonObject stats;
+    stats["issued"] = static_cast<double>(m_issued);
+    stats["accepted"] = static_cast<double>(m_accepted);
+    stats["rejected"] = static_cast<double>(m_rejected);
+    return stats;
+}
+
+QByteArray SessionTokens::sign(const QByteArray &payload) const
+{
+    return QMessageAuthenticationCode::hash(payload, m_secret, QCryptographicHash::Sha256);
+}
@@ -0,0 +1,55 @@
+#ifndef SESSIONTOKENS_H
+#define SESSIONTOKENS_H
+
+#include <memory>
+#include <QByteArray>
+#include <QHash>
+#include <QJsonObject>
+#include <QMutex>
+#include <QString>
+
+class User;
+
+// Signed, expiring session tokens handed out with LOGIN_SUCCESS. RESUME_SESSION trades one for
+// the logged in user: the token carries the user's id, name, role and login time, and an
+// HMAC-SHA256 over them proves the server issued it. Servers sharing a secret accept each
+// other's tokens. A token renewed on resume keeps the login time, so a session ends a lifetime
+// after LOGIN however often the client reconnects.
+class SessionTokens
+{
+public:
+    static SessionTokens &instance();
+
+    // An empty secret picks a random one, so tokens die with the process.
+    // A lifetime of 0 disables tokens.
+    void configure(const QByteArray &secret, int lifetimeSec);
+    bool isEnabled() const;
+
+    // loggedInAt is the LOGIN time in milliseconds since the epoch; 0 means now
+    QString issue(const User &user, qint64 loggedInAt = 0);
+    // The user the token was issued to, or nullptr if it is malformed, forged, expired or
+    // was revoked. Sets loggedInAt to the login time it carries.
+    std::shared_ptr<User> verify(const QString &token, qint64 *loggedInAt = nullptr);
+    // Rejects the user's tokens issued so far, e.g. once the account is deleted. The list only
+    // lives in memory, so RESUME_SESSION also checks the account against the database.
+    void revokeUser(int userId);
+
+    QJsonObject statistics() const;
+
+private:
+    SessionTokens();
+    SessionTokens(const SessionTokens &) = delete;
+    SessionTokens &operator=(const SessionTokens &) = delete;
+
+    QByteArray sign(const QByteArray &payload) const;
+
+    mutable QMutex m_mutex;
+    QByteArray m_secret;
+    int m_lifetimeSec = 0;
+    QHash<int, qint64> m_revokedBefore; // user_id -> tokens issued before this are invalid
+    quint64 m_issued = 0;
+    quint64 m_accepted = 0;
+    quint64 m_rejected = 0;
+};
+
+#endif // SESSIONTOKENS_H
@@ -0,0 +1,31 @@
+#include "tokenbucket.h"
+#include <cmath>
+
+TokenBucket::TokenBucket(double ratePerSec, double burst)
+    : m_ratePerMs(qMax(0.0, ratePerSec) / 1000)
+    , m_burst(qMax(1.0, burst))
+    , m_tokens(m_burst)
+{}
+
+int TokenBucket::waitFor(qint64 nowMs, int count)
+{
+    if (m_ratePerMs <= 0 || count <= 0)
+        return 0;
+
+    if (m_lastRefillMs >= 0) {
+        m_tokens = qMin(m_burst, m_tokens + (nowMs - m_lastRefillMs) * m_ratePerMs);
+    }
+    m_lastRefillMs = nowMs;
+
+    double needed = qMin(double(count), m_burst);
+    if (m_tokens >= needed)
+        return 0;
+    return qMax(1, static_cast<int>(std::ceil((needed - m_tokens) / m_ratePerMs)));
+}
+
+void TokenBucket::take(int count)
+{
+    if (m_ratePerMs > 0) {
+        m_tokens -= count;
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef TOKENBUCKET_H
+#define TOKENBUCKET_H
+
+#include <QtGlobal>
+
+// Rate limit allowing ratePerSec commands on average and bursts of up to burst commands.
+// Not thread safe; each client handler keeps its own.
+class TokenBucket
+{
+public:
+    // A rate of 0 lets everything through
+    explicit TokenBucket(double ratePerSec = 0, double burst = 1);
+
+    // Milliseconds until count tokens are available at nowMs, a monotonic time; 0 if they are
+    // now. A count above the burst only waits for a full bucket.
+    int waitFor(qint64 nowMs, int count);
+    // Takes count tokens once waitFor() said they are available. Taking more than the bucket
+    // holds leaves it in debt, which later commands wait out.
+    void take(int count);
+
+private:
+    double m_ratePerMs;
+    double m_burst;
+    double m_tokens;
+    qint64 m_lastRefillMs = -1;
+};
+
+#endif // TOKENBUCKET_H
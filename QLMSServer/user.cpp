@@ -1,8 +1,9 @@
 #include "user.h"
 
-User::User(int id, const QString &username)
+User::User(int id, const QString &username, UserRole role)
     : m_id(id)
     , m_username(username)
+    , m_role(role)
 {}
 
 QJsonObject User::toJson() const
@@ -15,13 +16,13 @@ QJsonObject User::toJson() const
 }
 
 Admin::Admin(int id, const QString &username)
-    : User(id, username)
+    : User(id, username, UserRole::Admin)
 {}
 
 Instructor::Instructor(int id, const QString &username)
-    : User(id, username)
+    : User(id, username, UserRole::Instructor)
 {}
 
 Student::Student(int id, const QString &username)
-    : User(id, username)
+    : User(id, username, UserRole::Student)
 {}
@@ -1,13 +1,22 @@
 #ifndef USER_H
 #define USER_H
 
+#include <QFlags>
 #include <QJsonObject>
 #include <QString>
 
+enum class UserRole {
+    Admin = 0x1,
+    Instructor = 0x2,
+    Student = 0x4,
+};
+Q_DECLARE_FLAGS(UserRoles, UserRole)
+Q_DECLARE_OPERATORS_FOR_FLAGS(UserRoles)
+
 class User
 {
 public:
-    User(int id = 0, const QString &username = QString());
+    User(int id, const QString &username, UserRole role);
     virtual ~User() = default;
 
     int getId() const { return m_id; }
@@ -19,6 +28,9 @@ public:
     QString getPasswordHash() const { return m_passwordHash; }
     void setPasswordHash(const QString &hash) { m_passwordHash = hash; }
 
+    // Cheap role check for authorization; getRole() is the wire/database name
+    UserRole getUserRole() const { return m_role; }
+
     virtual QString getRole() const = 0;
     virtual QJsonObject toJson() const;
 
@@ -26,6 +38,7 @@ protected:
     int m_id;
     QString m_username;
     QString m_passwordHash;
+    UserRole m_role;
 };
 
 class Admin : public User
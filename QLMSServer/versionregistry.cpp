@@ -0,0 +1,44 @@
+#include "versionregistry.h"
+#include <QDateTime>
+
+VersionRegistry::VersionRegistry()
+    : m_counter(QDateTime::currentMSecsSinceEpoch())
+    , m_floor(m_counter)
+{}
+
+qint64 VersionRegistry::version(const QString &key) const
+{
+    QMutexLocker locker(&m_mutex);
+    return qMax(m_floor, m_versions.value(key));
+}
+
+bool VersionRegistry::matches(const QString &key, qint64 clientVersion)
+{
+    QMutexLocker locker(&m_mutex);
+    bool current = clientVersion == qMax(m_floor, m_versions.value(key));
+    ++(current ? m_notModified : m_modified);
+    return current;
+}
+
+void VersionRegistry::bump(const QString &key)
+{
+    QMutexLocker locker(&m_mutex);
+    m_versions.insert(key, ++m_counter);
+}
+
+void VersionRegistry::bumpAll()
+{
+    QMutexLocker locker(&m_mutex);
+    m_floor = ++m_counter;
+    m_versions.clear(); // Every entry is now below the floor
+}
+
+QJsonObject VersionRegistry::statistics() const
+{
+    QMutexLocker locker(&m_mutex);
+    QJsonObject stats;
+    stats["keys"] = m_versions.size();
+    stats["not_modified"] = static_cast<double>(m_notModified);
+    stats["modified"] = static_cast<double>(m_modified);
+    return stats;
+}
@@ -0,0 +1,37 @@
+#ifndef VERSIONREGISTRY_H
+#define VERSIONREGISTRY_H
+
+#include <QHash>
+#include <QJsonObject>
+#include <QMutex>
+#include <QString>
+
+// Server-wide version stamps for cacheable responses, keyed like "material:12" or "course:3".
+// A key's version only grows: writes through DatabaseManager bump the keys they affect, and
+// bumpAll() covers changes whose reach isn't known, such as cascading deletes. Versions start at
+// the startup time in milliseconds, so stamps handed out by an earlier run compare as stale.
+class VersionRegistry
+{
+public:
+    VersionRegistry();
+
+    qint64 version(const QString &key) const;
+
+    // True if the client's copy is current; counted for the statistics
+    bool matches(const QString &key, qint64 clientVersion);
+
+    void bump(const QString &key);
+    void bumpAll();
+
+    QJsonObject statistics() const;
+
+private:
+    mutable QMutex m_mutex;
+    QHash<QString, qint64> m_versions;
+    qint64 m_counter;
+    qint64 m_floor; // Version of every key not bumped since the last bumpAll()
+    quint64 m_notModified = 0;
+    quint64 m_modified = 0;
+};
+
+#endif // VERSIONREGISTRY_H
@@ -1,10 +1,26 @@
 #!/bin/bash
-echo "Generating SSL certificate..."
+# Usage: ./generate_ssl.sh [ecdsa|rsa]
+# ECDSA (P-256) is the default: its handshakes cost the server far less CPU than RSA ones.
+KEY_TYPE="${1:-ecdsa}"
+
+echo "Generating SSL certificate ($KEY_TYPE)..."
 
 pushd QLMSServer > /dev/null
 
 # Generate private key
-openssl genrsa -out server.key 2048
+case "$KEY_TYPE" in
+    ecdsa)
+        openssl ecparam -name prime256v1 -genkey -noout -out server.key
+        ;;
+    rsa)
+        openssl genrsa -out server.key 2048
+        ;;
+    *)
+        echo "Unknown key type '$KEY_TYPE', expected ecdsa or rsa"
+        popd > /dev/null
+        exit 1
+        ;;
+esac
 
 # Generate certificate signing request
 openssl req -new -key server.key -out server.csr \
@@ -43,6 +43,9 @@ CREATE TABLE text_lessons (
     content TEXT NOT NULL
 );
 
+-- Keep lesson text uncompressed out of line so substring() reads only the slices it needs
+ALTER TABLE text_lessons ALTER COLUMN content SET STORAGE EXTERNAL;
+
 CREATE TABLE quizzes (
     quiz_id INTEGER PRIMARY KEY REFERENCES course_materials(material_id) ON DELETE CASCADE,
     max_attempts INTEGER NOT NULL DEFAULT 1,
@@ -97,7 +100,8 @@ CREATE TABLE answers (
 CREATE INDEX idx_users_role ON users(role);
 CREATE INDEX idx_course_materials_type ON course_materials(type);
 CREATE INDEX idx_quiz_attempts_status ON quiz_attempts(status);
-CREATE INDEX idx_quiz_attempts_student ON quiz_attempts(student_id);
+CREATE INDEX idx_quiz_attempts_student ON quiz_attempts(student_id, submitted_at DESC, attempt_id DESC);
 CREATE INDEX idx_answers_attempt ON answers(attempt_id);
 CREATE INDEX idx_course_materials_course_id ON course_materials(course_id);
-CREATE INDEX idx_class_members_user_id ON class_members(user_id);
\ No newline at end of file
+CREATE INDEX idx_class_members_user_id ON class_members(user_id);
+CREATE INDEX idx_courses_class_id ON courses(class_id);
\ No newline at end of file